@@ -1,19 +1,25 @@
 # ChessGame.pro
-QT += core gui
+QT += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = ChessGame
 TEMPLATE = app
+CONFIG += c++17
 
-SOURCES += main.cpp \
+include(core.pri)
+
+SOURCES += boardscene.cpp \
+           enginehost.cpp \
+           main.cpp \
            mainwindow.cpp \
-           piece.cpp \
-           terrain.cpp
+           netclient.cpp \
+           piece.cpp
 
-HEADERS += mainwindow.h \
-           piece.h \
-           terrain.h \
-           terrain.h
+HEADERS += boardscene.h \
+           enginehost.h \
+           mainwindow.h \
+           netclient.h \
+           piece.h
 
 FORMS += mainwindow.ui
@@ -0,0 +1,213 @@
+// bitboard.h
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+// one bit per square of a Cols x Rows board, bit n is square n = y * Cols + x;
+// the squares fill 64-bit words from the lowest, the 11x11 board takes two words
+// and a 32x32 board sixteen. Every operation is a loop over a fixed number of
+// words, so the compiler unrolls the small boards and vectorizes the large ones
+template <int Cols, int Rows>
+struct BasicBitboard {
+    static constexpr int Squares = Cols * Rows;
+    static constexpr int Words = (Squares + 63) / 64;
+
+    std::uint64_t words[Words] = {};
+
+    constexpr BasicBitboard() = default;
+
+    // the two-word board picks its word with a select instead of an index, so the
+    // words stay in registers: the 11x11 board runs as fast as a hand-written pair
+    static constexpr BasicBitboard square(int sq) {
+        BasicBitboard b;
+        if constexpr (Words == 2) {
+            b.words[0] = sq < 64 ? std::uint64_t(1) << sq : 0;
+            b.words[1] = sq < 64 ? 0 : std::uint64_t(1) << (sq - 64);
+        } else {
+            b.words[sq >> 6] = std::uint64_t(1) << (sq & 63);
+        }
+        return b;
+    }
+    static constexpr BasicBitboard full() {
+        BasicBitboard b;
+        for (int i = 0; i < Words; ++i) {
+            b.words[i] = ~std::uint64_t(0);
+        }
+        if (Squares % 64) {
+            b.words[Words - 1] = (std::uint64_t(1) << (Squares % 64)) - 1;
+        }
+        return b;
+    }
+
+    // one column of the board, used to stop east/west shifts from wrapping rows
+    static constexpr BasicBitboard column(int x) {
+        BasicBitboard mask;
+        for (int y = 0; y < Rows; ++y) {
+            mask.set(y * Cols + x);
+        }
+        return mask;
+    }
+
+    constexpr bool test(int sq) const {
+        if constexpr (Words == 2) {
+            return sq < 64 ? (words[0] >> sq) & 1 : (words[1] >> (sq - 64)) & 1;
+        }
+        return (words[sq >> 6] >> (sq & 63)) & 1;
+    }
+    constexpr void set(int sq) {
+        if constexpr (Words == 2) {
+            *this |= square(sq);
+            return;
+        }
+        words[sq >> 6] |= std::uint64_t(1) << (sq & 63);
+    }
+    constexpr void clear(int sq) {
+        if constexpr (Words == 2) {
+            *this &= ~square(sq);
+            return;
+        }
+        words[sq >> 6] &= ~(std::uint64_t(1) << (sq & 63));
+    }
+    constexpr bool any() const {
+        std::uint64_t bits = 0;
+        for (int i = 0; i < Words; ++i) {
+            bits |= words[i];
+        }
+        return bits != 0;
+    }
+    constexpr bool empty() const { return !any(); }
+    int count() const {
+        int total = 0;
+        for (int i = 0; i < Words; ++i) {
+            total += __builtin_popcountll(words[i]);
+        }
+        return total;
+    }
+
+    // lowest square in the set; the set must not be empty
+    int first() const {
+        if constexpr (Words == 2) {
+            return words[0] ? __builtin_ctzll(words[0]) : 64 + __builtin_ctzll(words[1]);
+        }
+        int i = 0;
+        while (!words[i]) {
+            ++i;
+        }
+        return i * 64 + __builtin_ctzll(words[i]);
+    }
+    int popFirst() {
+        if constexpr (Words == 2) {
+            int sq = first();
+            clear(sq);
+            return sq;
+        }
+        for (int i = 0; i < Words; ++i) {
+            if (words[i]) {
+                int sq = i * 64 + __builtin_ctzll(words[i]);
+                words[i] &= words[i] - 1;
+                return sq;
+            }
+        }
+        return -1;
+    }
+
+    constexpr BasicBitboard operator&(const BasicBitboard &o) const { BasicBitboard b = *this; return b &= o; }
+    constexpr BasicBitboard operator|(const BasicBitboard &o) const { BasicBitboard b = *this; return b |= o; }
+    constexpr BasicBitboard operator^(const BasicBitboard &o) const { BasicBitboard b = *this; return b ^= o; }
+    constexpr BasicBitboard operator~() const {
+        BasicBitboard b;
+        for (int i = 0; i < Words; ++i) {
+            b.words[i] = ~words[i];
+        }
+        return b & full();
+    }
+    constexpr BasicBitboard &operator&=(const BasicBitboard &o) {
+        for (int i = 0; i < Words; ++i) {
+            words[i] &= o.words[i];
+        }
+        return *this;
+    }
+    constexpr BasicBitboard &operator|=(const BasicBitboard &o) {
+        for (int i = 0; i < Words; ++i) {
+            words[i] |= o.words[i];
+        }
+        return *this;
+    }
+    constexpr BasicBitboard &operator^=(const BasicBitboard &o) {
+        for (int i = 0; i < Words; ++i) {
+            words[i] ^= o.words[i];
+        }
+        return *this;
+    }
+    constexpr bool operator==(const BasicBitboard &o) const {
+        std::uint64_t diff = 0;
+        for (int i = 0; i < Words; ++i) {
+            diff |= words[i] ^ o.words[i];
+        }
+        return diff == 0;
+    }
+    constexpr bool operator!=(const BasicBitboard &o) const { return !(*this == o); }
+
+    // towards the higher squares; bits past the last square are dropped
+    constexpr BasicBitboard operator<<(int n) const {
+        BasicBitboard b;
+        if constexpr (Words == 2) {
+            if (n == 0) return *this;
+            if (n >= 64) {
+                b.words[1] = words[0] << (n - 64);
+            } else {
+                b.words[0] = words[0] << n;
+                b.words[1] = (words[1] << n) | (words[0] >> (64 - n));
+            }
+            return b & full();
+        }
+        int wordShift = n >> 6;
+        int bitShift = n & 63;
+        for (int i = Words - 1; i >= wordShift; --i) {
+            std::uint64_t w = words[i - wordShift] << bitShift;
+            if (bitShift && i - wordShift > 0) {
+                w |= words[i - wordShift - 1] >> (64 - bitShift);
+            }
+            b.words[i] = w;
+        }
+        return b & full();
+    }
+    constexpr BasicBitboard operator>>(int n) const {
+        BasicBitboard b;
+        if constexpr (Words == 2) {
+            if (n == 0) return *this;
+            if (n >= 64) {
+                b.words[0] = words[1] >> (n - 64);
+            } else {
+                b.words[0] = (words[0] >> n) | (words[1] << (64 - n));
+                b.words[1] = words[1] >> n;
+            }
+            return b;
+        }
+        int wordShift = n >> 6;
+        int bitShift = n & 63;
+        for (int i = 0; i + wordShift < Words; ++i) {
+            std::uint64_t w = words[i + wordShift] >> bitShift;
+            if (bitShift && i + wordShift + 1 < Words) {
+                w |= words[i + wordShift + 1] << (64 - bitShift);
+            }
+            b.words[i] = w;
+        }
+        return b;
+    }
+
+    // one step in each direction, squares falling off the board are dropped
+    constexpr BasicBitboard north() const { return *this >> Cols; }
+    constexpr BasicBitboard south() const { return *this << Cols; }
+    constexpr BasicBitboard east() const { return (*this & ~column(Cols - 1)) << 1; }
+    constexpr BasicBitboard west() const { return (*this & ~column(0)) >> 1; }
+
+    // the square itself and its 8 neighbours
+    constexpr BasicBitboard area3x3() const {
+        BasicBitboard row = *this | east() | west();
+        return row | row.north() | row.south();
+    }
+};
+
+#endif // BITBOARD_H
@@ -0,0 +1,29 @@
+// board.h
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstdint>
+#include <type_traits>
+#include "bitboard.h"
+
+// the board size is fixed at compile time, 11x11 unless the build sets
+// CHESSGAME_BOARD_COLS / CHESSGAME_BOARD_ROWS (see core.pri)
+#ifndef CHESSGAME_BOARD_COLS
+#define CHESSGAME_BOARD_COLS 11
+#endif
+#ifndef CHESSGAME_BOARD_ROWS
+#define CHESSGAME_BOARD_ROWS 11
+#endif
+
+const int BoardCols = CHESSGAME_BOARD_COLS;
+const int BoardRows = CHESSGAME_BOARD_ROWS;
+const int BoardSquares = BoardCols * BoardRows;
+static_assert(BoardCols >= 11 && BoardCols <= 32 && BoardRows >= 11 && BoardRows <= 32,
+              "boards from 11x11 up to 32x32");
+
+using Bitboard = BasicBitboard<BoardCols, BoardRows>;
+
+// a square index, one byte up to 16x16
+using Square = std::conditional<(BoardSquares <= 256), std::uint8_t, std::uint16_t>::type;
+
+#endif // BOARD_H
@@ -0,0 +1,124 @@
+// boardscene.cpp
+#include "boardscene.h"
+#include <QGuiApplication>
+#include <QPainter>
+#include <vector>
+
+namespace {
+
+// by TerrainType; Land is a checkerboard
+QColor terrainColor(TerrainType type, int row, int col)
+{
+    switch (type) {
+    case TerrainType::Forest:   return QColor(34, 139, 34);
+    case TerrainType::River:    return QColor(30, 144, 255);
+    case TerrainType::Mountain: return QColor(165, 42, 42);
+    case TerrainType::Desert:   return QColor(210, 180, 140);
+    default:                    return (row + col) % 2 == 0 ? QColor(255, 255, 255) : QColor(200, 200, 200);
+    }
+}
+
+struct LegendItem {
+    QColor color;
+    const char *description;
+};
+
+// legends of the terrain
+const std::vector<LegendItem> terrainLegend = {
+    {QColor(34, 139, 34), "Forest"},
+    {QColor(30, 144, 255), "River"},
+    {QColor(165, 42, 42), "Mountain"},
+    {QColor(210, 180, 140), "Desert"},
+};
+
+// piece's legends
+const std::vector<LegendItem> pieceLegend = {
+    {QColor(0, 0, 255), "Knight"},
+    {QColor(255, 0, 0), "Bomb"},
+    {QColor(0, 255, 0), "Pawn"},
+    {QColor(204, 0, 204), "Queen"},
+    {QColor(255, 255, 0), "King"},
+    {QColor(51, 255, 255), "Bishop"},
+};
+
+} // namespace
+
+BoardScene::BoardScene(const Terrain &terrain, QObject *parent)
+    : QGraphicsScene(0, 0, BoardCols * CellSize + 151, BoardRows * CellSize + 151, parent)
+{
+    setTerrain(terrain);
+}
+
+void BoardScene::setTerrain(const Terrain &map)
+{
+    terrain = map;
+
+    // at the resolution of the screen, so it stays sharp on high-DPI displays
+    qreal ratio = qApp->devicePixelRatio();
+    background = QPixmap((sceneRect().size() * ratio).toSize());
+    background.setDevicePixelRatio(ratio);
+    background.fill(Qt::white);
+    QPainter painter(&background);
+    paintBoard(painter);
+    paintLegend(painter);
+    painter.end();
+
+    invalidate(sceneRect(), BackgroundLayer);
+}
+
+void BoardScene::drawBackground(QPainter *painter, const QRectF &rect)
+{
+    painter->fillRect(rect, Qt::white);
+    // only the exposed part of the pixmap
+    QRectF exposed = rect.intersected(QRectF(QPointF(0, 0), sceneRect().size()));
+    qreal ratio = background.devicePixelRatio();
+    painter->drawPixmap(exposed, background,
+                        QRectF(exposed.topLeft() * ratio, exposed.size() * ratio));
+}
+
+void BoardScene::paintBoard(QPainter &painter) const
+{
+    painter.setPen(QPen(Qt::black));
+    for (int row = 0; row < terrain.getRows(); ++row) {
+        for (int col = 0; col < terrain.getCols(); ++col) {
+            painter.setBrush(terrainColor(terrain.getTerrain(row, col), row, col));
+            painter.drawRect(col * CellSize, row * CellSize, CellSize, CellSize);
+        }
+    }
+}
+
+void BoardScene::paintLegend(QPainter &painter) const
+{
+    const int legendX = BoardCols * CellSize + 50;
+    const int legendY = 20;
+    const int rectSize = 20;
+    const int spacing = 10;
+    const int textOffset = 25;
+    const int textMargin = 4; // of the text items the legend used to be made of
+
+    auto heading = [&](const char *text, int y) {
+        painter.drawText(QPointF(legendX + textMargin, y + textMargin + painter.fontMetrics().ascent()), text);
+    };
+    auto entries = [&](const std::vector<LegendItem> &items, int &y) {
+        for (const auto &item : items) {
+            painter.setBrush(item.color);
+            painter.drawRect(legendX, y, rectSize, rectSize);
+            painter.drawText(QPointF(legendX + textOffset + textMargin,
+                                     y - 5 + textMargin + painter.fontMetrics().ascent()),
+                             item.description);
+            y += rectSize + spacing;
+        }
+    };
+
+    painter.setPen(QPen(Qt::black));
+    painter.setFont(font());
+    int y = legendY;
+    heading("Terrain Legend:", y);
+    y += rectSize + spacing;
+    entries(terrainLegend, y);
+
+    y += spacing;
+    heading("Piece Legend:", y);
+    y += rectSize + spacing;
+    entries(pieceLegend, y);
+}
@@ -0,0 +1,33 @@
+// boardscene.h
+#ifndef BOARDSCENE_H
+#define BOARDSCENE_H
+
+#include <QGraphicsScene>
+#include <QPixmap>
+#include "terrain.h"
+
+// the scene of the game: the terrain grid and the legend are painted once into a
+// pixmap that drawBackground copies, so the scene holds only the pieces and the
+// passing messages. Views should cache their background too (CacheBackground)
+class BoardScene : public QGraphicsScene
+{
+public:
+    static const int CellSize = 50;
+
+    explicit BoardScene(const Terrain &terrain, QObject *parent = nullptr);
+
+    // repaints the pixmap, the only time it changes
+    void setTerrain(const Terrain &terrain);
+
+protected:
+    void drawBackground(QPainter *painter, const QRectF &rect) override;
+
+private:
+    void paintBoard(QPainter &painter) const;
+    void paintLegend(QPainter &painter) const;
+
+    Terrain terrain;
+    QPixmap background;
+};
+
+#endif // BOARDSCENE_H
@@ -0,0 +1,198 @@
+// book.cpp
+#include "book.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace {
+
+const char BookMagic[4] = {'C', 'G', 'B', 'K'};
+
+bool fail(std::string *error, const std::string &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+std::uint64_t nextRandom(std::uint64_t &state)
+{
+    // splitmix64
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct ActionTally {
+    std::uint32_t plays = 0;
+    std::uint32_t halfPoints = 0; // 2 for a win of the player who played it, 1 for a draw
+};
+
+// points of the player to move at a position for the end of the game
+int halfPointsFor(GameResult result, bool playerOne)
+{
+    switch (result) {
+    case GameResult::PlayerOneWins: return playerOne ? 2 : 0;
+    case GameResult::PlayerTwoWins: return playerOne ? 0 : 2;
+    default:                        return 1;
+    }
+}
+
+} // namespace
+
+bool OpeningBook::open(const std::string &path, std::string *error)
+{
+    entries = nullptr;
+    count = 0;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    if (file.size() < sizeof(BookHeader) || std::memcmp(file.data(), BookMagic, sizeof(BookMagic)) != 0) {
+        return fail(error, path + " is not an opening book");
+    }
+    const BookHeader *header = reinterpret_cast<const BookHeader *>(file.data());
+    if (header->cols != BoardCols || header->rows != BoardRows) {
+        return fail(error, path + " is for another board size");
+    }
+    if (file.size() < sizeof(BookHeader) + std::size_t(header->entryCount) * sizeof(BookEntry)) {
+        return fail(error, path + " is truncated");
+    }
+    entries = reinterpret_cast<const BookEntry *>(file.data() + sizeof(BookHeader));
+    count = header->entryCount;
+    return true;
+}
+
+const BookEntry *OpeningBook::find(std::uint64_t key, std::size_t &found) const
+{
+    const BookEntry *end = entries + count;
+    const BookEntry *first = std::lower_bound(entries, end, key,
+                                              [](const BookEntry &entry, std::uint64_t k) { return entry.key < k; });
+    const BookEntry *last = first;
+    while (last != end && last->key == key) {
+        ++last;
+    }
+    found = static_cast<std::size_t>(last - first);
+    return first;
+}
+
+bool OpeningBook::pick(const BoardState &state, std::uint64_t random, Action &action) const
+{
+    // the book is built from games on the standard terrain, the key does not tell
+    if (!entries || state.result != GameResult::Ongoing || !state.hasTerrain(defaultTerrain)) {
+        return false;
+    }
+    std::size_t found;
+    const BookEntry *first = find(state.hash, found);
+    if (found == 0) {
+        return false;
+    }
+    std::uint32_t total = 0;
+    for (std::size_t i = 0; i < found; ++i) {
+        total += first[i].weight;
+    }
+    std::uint32_t draw = static_cast<std::uint32_t>(nextRandom(random) % std::max<std::uint32_t>(total, 1));
+    for (std::size_t i = 0; i < found; ++i) {
+        if (draw >= first[i].weight) {
+            draw -= first[i].weight;
+            continue;
+        }
+        // a key collision or a damaged file must not play an illegal action
+        if (first[i].code / 25 >= BoardSquares) {
+            return false;
+        }
+        Action chosen = decodeAction(first[i].code);
+        ActionList legal;
+        generatePieceActions(state, chosen.from, legal);
+        if (std::find(legal.begin(), legal.end(), chosen) == legal.end()) {
+            return false;
+        }
+        action = chosen;
+        return true;
+    }
+    return false;
+}
+
+bool buildOpeningBook(const std::vector<std::string> &paths, const std::string &output, const BookOptions &options,
+                      BookBuildStats *stats, std::string *error)
+{
+    std::vector<std::string> files;
+    if (!listRecordFiles(paths, files, error)) {
+        return false;
+    }
+
+    const std::vector<TerrainType> standardTerrain = scenarioFromState(initialBoardState()).terrain;
+    std::map<std::pair<std::uint64_t, std::uint16_t>, ActionTally> tallies;
+    BookBuildStats counted;
+    for (const std::string &file : files) {
+        GameRecord record;
+        BoardState end;
+        if (!loadRecordFile(file, record) || record.start.terrain != standardTerrain
+            || !replayRecord(record, -1, end)) {
+            ++counted.skipped;
+            continue;
+        }
+        ++counted.games;
+        BoardState state;
+        scenarioToState(record.start, state);
+        std::size_t plies = std::min(record.actions.size(), static_cast<std::size_t>(std::max(0, options.maxPlies)));
+        for (std::size_t i = 0; i < plies; ++i) {
+            ActionTally &tally = tallies[{state.hash, encodeAction(record.actions[i])}];
+            ++tally.plays;
+            tally.halfPoints += static_cast<std::uint32_t>(halfPointsFor(end.result, state.playerOneToMove()));
+            applyAction(state, record.actions[i]);
+        }
+    }
+
+    // the map is in key order already; weights are scaled per position so the best is 65535
+    std::vector<BookEntry> entries;
+    auto position = tallies.begin();
+    while (position != tallies.end()) {
+        auto next = position;
+        std::vector<std::pair<std::uint16_t, double>> scored;
+        std::vector<std::uint32_t> plays;
+        for (; next != tallies.end() && next->first.first == position->first.first; ++next) {
+            const ActionTally &tally = next->second;
+            if (tally.plays < static_cast<std::uint32_t>(options.minPlays)) {
+                continue;
+            }
+            double score = (tally.halfPoints + 1.0) / (2.0 * tally.plays + 2.0);
+            scored.push_back({next->first.second, tally.plays * score * score});
+            plays.push_back(tally.plays);
+        }
+        double best = 0;
+        for (const auto &action : scored) {
+            best = std::max(best, action.second);
+        }
+        for (std::size_t i = 0; i < scored.size(); ++i) {
+            auto weight = static_cast<std::uint16_t>(std::max(1.0, 65535.0 * scored[i].second / best));
+            entries.push_back({position->first.first, scored[i].first, weight, plays[i]});
+        }
+        counted.positions += scored.empty() ? 0 : 1;
+        position = next;
+    }
+    counted.entries = entries.size();
+
+    BookHeader header = {};
+    std::memcpy(header.magic, BookMagic, sizeof(BookMagic));
+    header.cols = BoardCols;
+    header.rows = BoardRows;
+    header.entryCount = static_cast<std::uint32_t>(entries.size());
+    std::FILE *out = std::fopen(output.c_str(), "wb");
+    if (!out) {
+        return fail(error, "cannot write " + output);
+    }
+    std::fwrite(&header, sizeof(header), 1, out);
+    std::fwrite(entries.data(), sizeof(BookEntry), entries.size(), out);
+    bool written = std::ferror(out) == 0;
+    written = std::fclose(out) == 0 && written;
+    if (!written) {
+        return fail(error, "cannot write " + output);
+    }
+    if (stats) {
+        *stats = counted;
+    }
+    return true;
+}
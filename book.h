@@ -0,0 +1,65 @@
+// book.h
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "record.h"
+#include "scenario.h"
+
+// opening book from self-play on the standard terrain (.cgb), read through mmap:
+// a BookHeader, then BookEntry records sorted by key and action code, so the
+// actions of a position are one binary search away
+
+struct BookHeader {
+    char magic[4];              // "CGBK"
+    std::uint16_t cols;
+    std::uint16_t rows;
+    std::uint32_t entryCount;
+    std::uint32_t reserved;
+};
+
+struct BookEntry {
+    std::uint64_t key;          // Zobrist key of the position
+    std::uint16_t code;         // encodeAction()
+    std::uint16_t weight;       // chance to be played, relative to the other actions of the position
+    std::uint32_t plays;        // games that played it
+};
+
+class OpeningBook {
+public:
+    bool open(const std::string &path, std::string *error = nullptr);
+    bool isOpen() const { return entries != nullptr; }
+    std::size_t size() const { return count; }
+
+    // the entries of a position, none when it is out of book
+    const BookEntry *find(std::uint64_t key, std::size_t &found) const;
+    // a book action for the position, drawn by weight from random; false out of book
+    bool pick(const BoardState &state, std::uint64_t random, Action &action) const;
+
+private:
+    MappedFile file;
+    const BookEntry *entries = nullptr;
+    std::size_t count = 0;
+};
+
+struct BookOptions {
+    int maxPlies = 16;          // positions this deep into the games
+    int minPlays = 3;           // actions played fewer times are left out
+};
+
+struct BookBuildStats {
+    std::uint64_t games = 0;
+    std::uint64_t skipped = 0;  // other terrain, or a record that does not replay
+    std::uint64_t positions = 0;
+    std::uint64_t entries = 0;
+};
+
+// counts every action of the first plies of the records with the points it
+// brought its player; an action's weight grows with its plays and, squared, with
+// its score, unfinished games counting as draws. Paths as for listRecordFiles
+bool buildOpeningBook(const std::vector<std::string> &paths, const std::string &output, const BookOptions &options,
+                      BookBuildStats *stats = nullptr, std::string *error = nullptr);
+
+#endif // BOOK_H
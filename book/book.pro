@@ -0,0 +1,10 @@
+# book.pro
+# builds and shows the opening book from recorded self-play games
+TEMPLATE = app
+TARGET = book
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
@@ -0,0 +1,133 @@
+// main.cpp
+// book: opening book from recorded self-play games
+//
+//   book build OUT PATH... [--plies N] [--min-plays K]
+//   book show BOOK [--record FILE [--ply N]] [--bench]
+//
+// build counts the actions of the first N plies (16) of the records, from files or
+// directories of .cgr files such as tournament --record writes, and keeps those played
+// at least K times (3). show prints the book actions of the standard start, or of the
+// position after N actions of a record; --bench times book probes
+#include "book.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int usage()
+{
+    std::fprintf(stderr, "usage: book build OUT PATH... [--plies N] [--min-plays K]\n"
+                         "       book show BOOK [--record FILE [--ply N]] [--bench]\n");
+    return 2;
+}
+
+static int build(int argc, char *argv[])
+{
+    const char *output = nullptr;
+    std::vector<std::string> paths;
+    BookOptions options;
+    for (int i = 2; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--plies") == 0 && hasValue) {
+            options.maxPlies = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--min-plays") == 0 && hasValue) {
+            options.minPlays = std::max(1, std::atoi(argv[++i]));
+        } else if (!output) {
+            output = argv[i];
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (!output || paths.empty()) {
+        return usage();
+    }
+
+    BookBuildStats stats;
+    std::string error;
+    if (!buildOpeningBook(paths, output, options, &stats, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::printf("%llu games, %llu skipped: %llu positions, %llu actions\n", static_cast<unsigned long long>(stats.games),
+                static_cast<unsigned long long>(stats.skipped), static_cast<unsigned long long>(stats.positions),
+                static_cast<unsigned long long>(stats.entries));
+    return 0;
+}
+
+static int show(int argc, char *argv[])
+{
+    const char *path = argc > 2 ? argv[2] : nullptr;
+    const char *recordPath = nullptr;
+    int ply = -1;
+    bool bench = false;
+    for (int i = 3; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ply") == 0 && hasValue) {
+            ply = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            return usage();
+        }
+    }
+    if (!path) {
+        return usage();
+    }
+
+    OpeningBook book;
+    std::string error;
+    if (!book.open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    BoardState state = initialBoardState();
+    if (recordPath) {
+        GameRecord record;
+        if (!loadRecordFile(recordPath, record, &error) || !replayRecord(record, ply, state, &error)) {
+            std::fprintf(stderr, "%s: %s\n", recordPath, error.c_str());
+            return 1;
+        }
+    }
+
+    std::size_t found;
+    const BookEntry *entries = book.find(state.hash, found);
+    std::uint32_t total = 0;
+    for (std::size_t i = 0; i < found; ++i) {
+        total += entries[i].weight;
+    }
+    std::printf("position %016llx: %zu book actions of %zu entries\n", static_cast<unsigned long long>(state.hash),
+                found, book.size());
+    for (std::size_t i = 0; i < found; ++i) {
+        std::printf("  %-8s %5.1f%%  %u games\n", actionNotation(decodeAction(entries[i].code)).c_str(),
+                    100.0 * entries[i].weight / total, entries[i].plays);
+    }
+
+    if (bench) {
+        const int rounds = 1000000;
+        Action action;
+        int hits = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            hits += book.pick(state, static_cast<std::uint64_t>(i), action);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("probe %.0f ns, %d hits\n", 1e9 * seconds / rounds, hits);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::strcmp(argv[1], "build") == 0) {
+        return build(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "show") == 0) {
+        return show(argc, argv);
+    }
+    return usage();
+}
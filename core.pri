@@ -0,0 +1,41 @@
+# core.pri
+# headless rules core, shared by the game and the command-line tools
+INCLUDEPATH += $$PWD
+CONFIG += thread # the search runs helper threads
+
+# the board is 11x11 unless the build picks another size, up to 32x32:
+#   qmake "DEFINES += CHESSGAME_BOARD_COLS=15 CHESSGAME_BOARD_ROWS=15"
+
+SOURCES += $$PWD/book.cpp \
+           $$PWD/eval.cpp \
+           $$PWD/mcts.cpp \
+           $$PWD/movegen.cpp \
+           $$PWD/posdb.cpp \
+           $$PWD/protocol.cpp \
+           $$PWD/record.cpp \
+           $$PWD/rules.cpp \
+           $$PWD/scenario.cpp \
+           $$PWD/search.cpp \
+           $$PWD/tablebase.cpp \
+           $$PWD/terrain.cpp \
+           $$PWD/tt.cpp \
+           $$PWD/zobrist.cpp
+
+HEADERS += $$PWD/bitboard.h \
+           $$PWD/board.h \
+           $$PWD/book.h \
+           $$PWD/eval.h \
+           $$PWD/mcts.h \
+           $$PWD/movegen.h \
+           $$PWD/movement.h \
+           $$PWD/pool.h \
+           $$PWD/posdb.h \
+           $$PWD/protocol.h \
+           $$PWD/record.h \
+           $$PWD/rules.h \
+           $$PWD/scenario.h \
+           $$PWD/search.h \
+           $$PWD/tablebase.h \
+           $$PWD/terrain.h \
+           $$PWD/tt.h \
+           $$PWD/zobrist.h
@@ -0,0 +1,131 @@
+// enginehost.cpp
+#include "enginehost.h"
+#include "eval.h"
+#include "record.h"
+
+// score of the side to move, forced results in plies
+static QString scoreText(int score)
+{
+    if (score >= MateScore - MaxMateDistance) {
+        return QString("win in %1").arg(MateScore - score);
+    }
+    if (score <= -(MateScore - MaxMateDistance)) {
+        return QString("loss in %1").arg(MateScore + score);
+    }
+    return QString::number(score);
+}
+
+EngineHost::EngineHost(QObject *parent)
+    : QObject(parent)
+    , worker(new QObject)
+{
+    qRegisterMetaType<Action>("Action");
+    engineLimits.timeMs = 1000;
+    mctsLimits.timeMs = 1000;
+    worker->moveToThread(&thread);
+    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+    thread.start();
+}
+
+EngineHost::~EngineHost()
+{
+    wanted = 0;
+    thread.quit();
+    thread.wait();
+}
+
+void EngineHost::setThreads(int count)
+{
+    QMetaObject::invokeMethod(worker, [this, count]() {
+        engine.setThreads(count);
+        mcts.setThreads(count);
+    }, Qt::QueuedConnection);
+}
+
+void EngineHost::setBook(const OpeningBook *book, std::uint64_t seed)
+{
+    QMetaObject::invokeMethod(worker, [this, book, seed]() {
+        openingBook = book;
+        bookSeed = seed;
+        mcts.setBook(book, seed);
+    }, Qt::QueuedConnection);
+}
+
+void EngineHost::setTablebases(const Tablebases *tables)
+{
+    QMetaObject::invokeMethod(worker, [this, tables]() {
+        engine.setTablebases(tables);
+        mcts.setTablebases(tables);
+    }, Qt::QueuedConnection);
+}
+
+void EngineHost::setUseMcts(bool use)
+{
+    QMetaObject::invokeMethod(worker, [this, use]() { useMcts = use; }, Qt::QueuedConnection);
+}
+
+quint64 EngineHost::think(const BoardState &state, const std::vector<std::uint64_t> &played)
+{
+    return post(state, played, false);
+}
+
+quint64 EngineHost::analyse(const BoardState &state, const std::vector<std::uint64_t> &played)
+{
+    return post(state, played, true);
+}
+
+void EngineHost::stop()
+{
+    wanted = 0;
+}
+
+quint64 EngineHost::post(const BoardState &state, const std::vector<std::uint64_t> &played, bool analysis)
+{
+    // raising wanted stops the job before, it reports and the engine thread moves on
+    quint64 job = ++lastJob;
+    wanted = job;
+    QMetaObject::invokeMethod(worker, [this, job, state, played, analysis]() {
+        run(job, state, played, analysis);
+    }, Qt::QueuedConnection);
+    return job;
+}
+
+void EngineHost::run(quint64 job, const BoardState &state, const std::vector<std::uint64_t> &played, bool analysis)
+{
+    if (wanted != job) {
+        return; // stopped or replaced while it waited
+    }
+    // the engines ask every 1024 nodes or every rollout, from all their threads
+    auto cancelled = [this, job]() { return wanted.load(std::memory_order_relaxed) != job; };
+    const QString label = analysis ? "Analysis" : "Thinking";
+
+    if (useMcts && !analysis) {
+        mcts.setCancel(cancelled);
+        mcts.setProgress([this, job, label](const MctsResult &report) {
+            emit progress(job, QString("%1: %2  win rate %3%  %4 rollouts")
+                                   .arg(label, QString::fromStdString(actionNotation(report.best)))
+                                   .arg(100 * report.winRate, 0, 'f', 1)
+                                   .arg(report.rollouts));
+        });
+        MctsResult result = mcts.think(state, mctsLimits);
+        emit finished(job, result.found, result.best);
+        return;
+    }
+
+    // an analysis looks past the book
+    engine.setBook(analysis ? nullptr : openingBook, bookSeed);
+    engine.setCancel(cancelled);
+    engine.setProgress([this, job, label](const SearchResult &report) {
+        emit progress(job, QString("%1: depth %2  %3  score %4  %5 knodes/s")
+                               .arg(label)
+                               .arg(report.depth)
+                               .arg(QString::fromStdString(actionNotation(report.best)), scoreText(report.score))
+                               .arg(report.seconds > 0 ? static_cast<qint64>(report.nodes / report.seconds / 1000) : 0));
+    });
+    SearchLimits limits = engineLimits;
+    if (analysis) {
+        limits.timeMs = 0;
+    }
+    SearchResult result = engine.think(state, limits, played);
+    emit finished(job, result.found, result.best);
+}
@@ -0,0 +1,63 @@
+// enginehost.h
+#ifndef ENGINEHOST_H
+#define ENGINEHOST_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "mcts.h"
+#include "search.h"
+
+Q_DECLARE_METATYPE(Action)
+
+// runs the engines on a thread of their own: the GUI thread hands over a copy of
+// the position and gets queued signals back, so it never waits for a search.
+// Every request is a numbered job, the signals carry the number so the answers to
+// abandoned jobs can be told apart; only the newest job runs, a new one stops the last
+class EngineHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EngineHost(QObject *parent = nullptr);
+    ~EngineHost();
+
+    // settings reach the engine thread between two jobs
+    void setThreads(int count);
+    void setBook(const OpeningBook *book, std::uint64_t seed);
+    void setTablebases(const Tablebases *tables);
+    void setUseMcts(bool use);
+
+    // an action for the side to move within the time limit of the engine picked
+    quint64 think(const BoardState &state, const std::vector<std::uint64_t> &played);
+    // alpha-beta with no time limit, progress only until stop()
+    quint64 analyse(const BoardState &state, const std::vector<std::uint64_t> &played);
+    // ends the running job within a few hundred microseconds, it still reports the
+    // best action found so far; a job not started yet does not run
+    void stop();
+
+signals:
+    void progress(quint64 job, const QString &text);
+    void finished(quint64 job, bool found, Action best);
+
+private:
+    quint64 post(const BoardState &state, const std::vector<std::uint64_t> &played, bool analysis);
+    void run(quint64 job, const BoardState &state, const std::vector<std::uint64_t> &played, bool analysis);
+
+    QThread thread;
+    QObject *worker; // lives on thread, runs the posted jobs in order
+    Search engine;   // the engines and their settings belong to the engine thread
+    SearchLimits engineLimits;
+    Mcts mcts;
+    MctsLimits mctsLimits;
+    const OpeningBook *openingBook = nullptr;
+    std::uint64_t bookSeed = 0;
+    bool useMcts = false;
+    quint64 lastJob = 0;                // numbered on the GUI thread
+    std::atomic<quint64> wanted{0};     // the job allowed to run, 0 for none
+};
+
+#endif // ENGINEHOST_H
@@ -0,0 +1,111 @@
+// eval.cpp
+#include "eval.h"
+
+int pieceValue(PieceType type)
+{
+    switch (type) {
+    case PieceType::Pawn:   return 100;
+    case PieceType::Knight: return 350;
+    case PieceType::Bishop: return 300;
+    case PieceType::Bomb:   return 400;
+    case PieceType::Queen:  return 700;
+    case PieceType::King:   return 2000; // only matters for ordering, losing it ends the game
+    default:                return 0;
+    }
+}
+
+namespace {
+
+// bonus for each ability use still in hand
+int abilityValue(PieceType type)
+{
+    switch (type) {
+    case PieceType::Knight: return 60;
+    case PieceType::King:   return 30;
+    case PieceType::Bishop: return 50;
+    default:                return 0;
+    }
+}
+
+// material, ability budgets and progress of one player
+int sideScore(const BoardState &state, int owner)
+{
+    bool isPlayerOne = owner == 0;
+    int score = 0;
+    Bitboard mine = state.occupancy[owner];
+    while (mine.any()) {
+        int sq = mine.popFirst();
+        const PieceState &piece = state.squares[sq];
+        if (piece.type != PieceType::King) {
+            score += pieceValue(piece.type);
+        }
+        score += abilityValue(piece.type) * piece.abilityUsesLeft;
+
+        // rows gained towards the enemy side, the King stays home
+        int row = sq / BoardCols;
+        int advance = isPlayerOne ? row : BoardRows - 1 - row;
+        if (piece.type == PieceType::King) {
+            score -= 8 * advance;
+        } else {
+            score += 4 * advance;
+        }
+    }
+
+    // every piece is worth more once few are left: losing the last one loses the game
+    int count = state.pieceCount[owner];
+    if (count <= 3) {
+        score -= (4 - count) * 150;
+    }
+
+    // an enemy Bomb next to the King can take it with one detonation
+    Bitboard king = state.pieces[owner][static_cast<int>(PieceType::King)];
+    Bitboard enemyBombs = state.pieces[1 - owner][static_cast<int>(PieceType::Bomb)];
+    if ((king.area3x3().area3x3() & enemyBombs).any()) {
+        score -= 150;
+    }
+    return score;
+}
+
+} // namespace
+
+int evaluate(const BoardState &state)
+{
+    int owner = BoardState::side(state.playerOneToMove());
+    return sideScore(state, owner) - sideScore(state, 1 - owner);
+}
+
+int terminalScore(const BoardState &state, int ply)
+{
+    if (state.result == GameResult::Draw || state.result == GameResult::Ongoing) {
+        return 0;
+    }
+    bool playerOneWon = state.result == GameResult::PlayerOneWins;
+    return playerOneWon == state.playerOneToMove() ? MateScore - ply : -(MateScore - ply);
+}
+
+// the 3x3 area of a Bomb, the four (2, 2) corners of a Queen
+int abilityGain(const BoardState &state, const Action &action)
+{
+    const PieceState &piece = state.squares[action.from];
+    int enemy = 1 - BoardState::side(piece.isPlayerOne);
+    Bitboard area;
+    if (piece.type == PieceType::Bomb) {
+        area = Bitboard::square(action.from).area3x3();
+    } else if (piece.type == PieceType::Queen) {
+        Bitboard queen = Bitboard::square(action.from);
+        Bitboard columns = queen.east().east() | queen.west().west();
+        area = columns.north().north() | columns.south().south();
+    } else {
+        return 0;
+    }
+
+    int gain = piece.type == PieceType::Bomb ? -pieceValue(PieceType::Bomb) : 0;
+    Bitboard victims = area & state.occupied();
+    victims.clear(action.from);
+    while (victims.any()) {
+        int sq = victims.popFirst();
+        int value = pieceValue(state.squares[sq].type);
+        gain += state.occupancy[enemy].test(sq) ? value : -value;
+    }
+    return gain;
+}
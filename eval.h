@@ -0,0 +1,23 @@
+// eval.h
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "movegen.h"
+
+// scores are in hundredths of a Pawn
+const int MateScore = 30000; // fits the 16-bit scores of the transposition table
+const int MaxMateDistance = 1000;
+
+int pieceValue(PieceType type);
+
+// static score of a running game, seen from the side to move
+int evaluate(const BoardState &state);
+
+// score of a finished game for the side to move, sooner wins count more
+int terminalScore(const BoardState &state, int ply);
+
+// material taken by a Bomb detonation or a Queen strike, own losses counted against it;
+// 0 for any other action
+int abilityGain(const BoardState &state, const Action &action);
+
+#endif // EVAL_H
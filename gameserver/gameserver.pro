@@ -0,0 +1,10 @@
+# gameserver.pro
+# many concurrent matches over TCP and Unix sockets with epoll (Linux), and a load generator
+TEMPLATE = app
+TARGET = gameserver
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
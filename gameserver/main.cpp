@@ -0,0 +1,1117 @@
+// main.cpp
+// gameserver: many matches in one process over TCP and Unix stream sockets (Linux, epoll)
+//
+//   gameserver serve [--tcp [HOST:]PORT] [--unix PATH] [--threads N] [--matches N]
+//   gameserver load (--tcp [HOST:]PORT | --unix PATH) [--matches N] [--games G]
+//                   [--threads N] [--max-plies P] [--seed S]
+//
+// serve runs one epoll loop per thread, every loop accepting from the same listening
+// sockets. The two seats of a match may be on different loops: a match is locked
+// while a message changes it, and the answers for a connection of another loop go
+// through that loop's inbox and its eventfd. Matches live in a table of --matches
+// slots (65536) allocated at the start; a match ends at the end of its game or when
+// a seat leaves or disconnects. SIGINT or SIGTERM stop the server with a summary.
+// load is the bundled load generator: N matches of two connections each, spread over
+// its threads, play G random games each (a game longer than P plies is left), and
+// it reports actions per second and the round trip of every action
+#include "protocol.h"
+#include "record.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static std::atomic<bool> running{true};
+
+static void onSignal(int)
+{
+    running = false;
+}
+
+static std::uint64_t nextRandom(std::uint64_t &state)
+{
+    // splitmix64
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// --tcp [HOST:]PORT or --unix PATH
+struct Endpoint {
+    bool local = false; // a Unix socket
+    std::string host = "127.0.0.1";
+    std::string port;
+    std::string path;
+};
+
+static bool parseTcp(const char *text, Endpoint &endpoint)
+{
+    std::string value = text;
+    std::size_t colon = value.rfind(':');
+    if (colon != std::string::npos) {
+        endpoint.host = value.substr(0, colon);
+        value = value.substr(colon + 1);
+    }
+    endpoint.port = value;
+    return std::atoi(value.c_str()) > 0;
+}
+
+static void setNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// a listening socket, or -1 with a message
+static int listenOn(const Endpoint &endpoint)
+{
+    int fd = -1;
+    if (endpoint.local) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (endpoint.path.size() >= sizeof(address.sun_path)) {
+            std::fprintf(stderr, "socket path too long: %s\n", endpoint.path.c_str());
+            return -1;
+        }
+        std::strcpy(address.sun_path, endpoint.path.c_str());
+        // the socket a server before this one left behind; any other file stays
+        struct stat existing;
+        if (lstat(endpoint.path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                std::fprintf(stderr, "%s exists and is not a socket\n", endpoint.path.c_str());
+                return -1;
+            }
+            unlink(endpoint.path.c_str());
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            std::perror(endpoint.path.c_str());
+            return -1;
+        }
+    } else {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo *found = nullptr;
+        if (getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &found) != 0 || !found) {
+            std::fprintf(stderr, "cannot resolve %s\n", endpoint.host.c_str());
+            return -1;
+        }
+        fd = socket(found->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        bool bound = fd >= 0 && bind(fd, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!bound) {
+            std::perror("bind");
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        std::perror("listen");
+        return -1;
+    }
+    setNonBlocking(fd);
+    return fd;
+}
+
+// a connected non-blocking socket, or -1
+static int connectTo(const Endpoint &endpoint)
+{
+    int fd = -1;
+    if (endpoint.local) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, endpoint.path.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+    } else {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *found = nullptr;
+        if (getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &found) != 0 || !found) {
+            return -1;
+        }
+        fd = socket(found->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool connected = fd >= 0 && connect(fd, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!connected) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    setNonBlocking(fd);
+    return fd;
+}
+
+// ---- server
+
+// a connection of one loop
+struct Seat {
+    int loop = -1; // -1: free
+    std::uint32_t connection = 0;
+
+    bool operator==(const Seat &o) const { return loop == o.loop && connection == o.connection; }
+};
+
+struct Match {
+    std::mutex lock;
+    std::uint32_t id = 0; // 0 while the slot is free
+    BoardState state;
+    Seat seats[2];
+};
+
+// every match slot allocated up front; an id is the slot and a generation that
+// changes on every reuse, so a stale id finds a slot that is no longer its match
+class MatchTable {
+public:
+    static const int SlotBits = 20;
+
+    explicit MatchTable(std::size_t capacity)
+        : matches(new Match[capacity]), generations(capacity, 0)
+    {
+        for (std::size_t slot = capacity; slot-- > 0;) {
+            freeSlots.push_back(static_cast<std::uint32_t>(slot));
+        }
+    }
+
+    // a new match, locked; null when the table is full
+    Match *create()
+    {
+        std::uint32_t slot;
+        std::uint32_t id;
+        {
+            std::lock_guard<std::mutex> guard(freeLock);
+            if (freeSlots.empty()) {
+                return nullptr;
+            }
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            generations[slot] = (generations[slot] + 1) & ((1u << (32 - SlotBits)) - 1);
+            if (generations[slot] == 0) {
+                generations[slot] = 1;
+            }
+            id = (generations[slot] << SlotBits) | slot;
+            ++created;
+        }
+        Match *match = &matches[slot];
+        match->lock.lock();
+        match->id = id;
+        match->state = initialBoardState();
+        match->seats[0] = Seat();
+        match->seats[1] = Seat();
+        return match;
+    }
+
+    // the match of id, locked; null when it is over or never was
+    Match *find(std::uint32_t id)
+    {
+        std::uint32_t slot = id & ((1u << SlotBits) - 1);
+        if (id == 0 || slot >= generations.size()) {
+            return nullptr;
+        }
+        Match *match = &matches[slot];
+        match->lock.lock();
+        if (match->id != id) {
+            match->lock.unlock();
+            return nullptr;
+        }
+        return match;
+    }
+
+    // ends a locked match and unlocks it
+    void release(Match *match)
+    {
+        std::uint32_t slot = match->id & ((1u << SlotBits) - 1);
+        match->id = 0;
+        match->lock.unlock();
+        std::lock_guard<std::mutex> guard(freeLock);
+        freeSlots.push_back(slot);
+    }
+
+    std::size_t active()
+    {
+        std::lock_guard<std::mutex> guard(freeLock);
+        return generations.size() - freeSlots.size();
+    }
+
+    std::uint64_t totalCreated()
+    {
+        std::lock_guard<std::mutex> guard(freeLock);
+        return created;
+    }
+
+private:
+    std::unique_ptr<Match[]> matches;
+    std::vector<std::uint32_t> generations;
+    std::vector<std::uint32_t> freeSlots;
+    std::uint64_t created = 0;
+    std::mutex freeLock;
+};
+
+struct Connection {
+    int fd = -1;
+    std::vector<std::uint8_t> in;
+    std::vector<std::uint8_t> out;
+    std::size_t sent = 0;           // of out
+    bool waitingToWrite = false;    // EPOLLOUT armed
+    bool dirty = false;             // has output to flush after this round of events
+    std::vector<std::uint32_t> matches; // seated in
+    std::uint32_t hosted = 0;       // the last match it created, one without a second seat at a time
+};
+
+class Server;
+
+// one epoll loop and the connections it accepted
+class Loop {
+public:
+    Loop(Server &server, int index);
+    ~Loop();
+
+    void run(const std::vector<int> &listeners);
+    // from any thread: message for a connection of this loop
+    void post(std::uint32_t connection, const Message &message);
+
+    std::uint64_t actions = 0;      // played on this loop
+    std::uint64_t accepted = 0;
+
+private:
+    // epoll data of the listeners, then the eventfd; connections use their id
+    static const std::uint64_t ListenerTag = 1ULL << 62;
+    static const std::uint64_t WakeTag = 1ULL << 63;
+
+    void accept(int listener);
+    void receive(std::uint32_t id);
+    void handle(std::uint32_t id, const Message &message);
+    void deliver(const Seat &seat, const Message &message); // through the inbox when on another loop
+    void send(std::uint32_t id, const Message &message);
+    void drainInbox();
+    void flush(std::uint32_t id);
+    void drop(std::uint32_t id); // closes and leaves its matches
+    void leave(std::uint32_t id, std::uint32_t matchId);
+    Seat self(std::uint32_t id) const { Seat seat; seat.loop = index; seat.connection = id; return seat; }
+
+    Server &server;
+    int index;
+    int epoll;
+    int wake;
+    std::unordered_map<std::uint32_t, Connection> connections;
+    std::uint32_t nextId = 1;
+    std::vector<std::uint32_t> dirty;
+    std::mutex inboxLock;
+    std::vector<std::pair<std::uint32_t, Message>> inbox;
+};
+
+class Server {
+public:
+    Server(int threads, std::size_t capacity) : matches(capacity)
+    {
+        for (int i = 0; i < threads; ++i) {
+            loops.emplace_back(new Loop(*this, i));
+        }
+    }
+
+    MatchTable matches;
+    std::vector<std::unique_ptr<Loop>> loops;
+};
+
+Loop::Loop(Server &server, int index)
+    : server(server), index(index), epoll(epoll_create1(EPOLL_CLOEXEC)), wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = WakeTag;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event);
+}
+
+Loop::~Loop()
+{
+    for (auto &entry : connections) {
+        close(entry.second.fd);
+    }
+    close(wake);
+    close(epoll);
+}
+
+void Loop::run(const std::vector<int> &listeners)
+{
+    // every loop waits on the listeners, EPOLLEXCLUSIVE wakes only one of them
+    for (std::size_t i = 0; i < listeners.size(); ++i) {
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.u64 = ListenerTag | i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, listeners[i], &event);
+    }
+
+    epoll_event events[256];
+    while (running) {
+        int count = epoll_wait(epoll, events, 256, 200);
+        for (int i = 0; i < count; ++i) {
+            std::uint64_t data = events[i].data.u64;
+            if (data & WakeTag) {
+                std::uint64_t value;
+                while (read(wake, &value, sizeof(value)) > 0) {
+                }
+                drainInbox();
+            } else if (data & ListenerTag) {
+                accept(listeners[data & ~ListenerTag]);
+            } else {
+                std::uint32_t id = static_cast<std::uint32_t>(data);
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    drop(id);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    receive(id);
+                }
+                if ((events[i].events & EPOLLOUT) && connections.count(id)) {
+                    flush(id);
+                }
+            }
+        }
+        // one write per connection and round, however many answers it got
+        std::vector<std::uint32_t> pending;
+        pending.swap(dirty);
+        for (std::uint32_t id : pending) {
+            flush(id);
+        }
+    }
+}
+
+void Loop::accept(int listener)
+{
+    for (;;) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN: another loop took it, or no more
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // fails harmlessly on Unix sockets
+        std::uint32_t id = nextId++;
+        Connection &connection = connections[id];
+        connection.fd = fd;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+        ++accepted;
+    }
+}
+
+void Loop::receive(std::uint32_t id)
+{
+    std::uint8_t buffer[65536];
+    for (;;) {
+        auto found = connections.find(id);
+        if (found == connections.end()) {
+            return;
+        }
+        Connection &connection = found->second;
+        ssize_t got = read(connection.fd, buffer, sizeof(buffer));
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) {
+            drop(id);
+            return;
+        }
+        if (got < 0) {
+            return;
+        }
+        connection.in.insert(connection.in.end(), buffer, buffer + got);
+
+        std::size_t used = 0;
+        for (;;) {
+            Message message;
+            int size = decodeMessage(connection.in.data() + used, connection.in.size() - used, message);
+            if (size == 0) {
+                break;
+            }
+            if (size < 0) {
+                Message refused;
+                refused.type = MessageType::Refused;
+                refused.reason = static_cast<std::uint8_t>(ServerError::BadMessage);
+                send(id, refused);
+                flush(id);
+                drop(id);
+                return;
+            }
+            used += static_cast<std::size_t>(size);
+            handle(id, message);
+            found = connections.find(id);
+            if (found == connections.end()) {
+                return;
+            }
+        }
+        Connection &still = found->second;
+        still.in.erase(still.in.begin(), still.in.begin() + static_cast<std::ptrdiff_t>(used));
+    }
+}
+
+void Loop::handle(std::uint32_t id, const Message &message)
+{
+    Message answer;
+    answer.match = message.match;
+    auto refuse = [&](std::uint8_t reason) {
+        answer.type = MessageType::Refused;
+        answer.reason = reason;
+        send(id, answer);
+    };
+
+    switch (message.type) {
+    case MessageType::Ping:
+        answer.type = MessageType::Pong;
+        answer.token = message.token;
+        send(id, answer);
+        return;
+
+    case MessageType::Create: {
+        // a connection cannot fill the table with matches nobody joins
+        if (Match *hosted = connections[id].hosted ? server.matches.find(connections[id].hosted) : nullptr) {
+            bool waiting = hosted->seats[1].loop < 0;
+            hosted->lock.unlock();
+            if (waiting) {
+                answer.match = connections[id].hosted;
+                refuse(static_cast<std::uint8_t>(ServerError::StillWaiting));
+                return;
+            }
+        }
+        Match *match = server.matches.create();
+        if (!match) {
+            refuse(static_cast<std::uint8_t>(ServerError::ServerFull));
+            return;
+        }
+        match->seats[0] = self(id);
+        answer.type = MessageType::Joined;
+        answer.match = match->id;
+        answer.seat = 1;
+        match->lock.unlock();
+        connections[id].matches.push_back(answer.match);
+        connections[id].hosted = answer.match;
+        send(id, answer);
+        return;
+    }
+
+    case MessageType::Join: {
+        Match *match = server.matches.find(message.match);
+        if (!match) {
+            refuse(static_cast<std::uint8_t>(ServerError::NoMatch));
+            return;
+        }
+        if (match->seats[1].loop >= 0 || match->seats[0] == self(id)) {
+            match->lock.unlock();
+            refuse(static_cast<std::uint8_t>(ServerError::MatchFull));
+            return;
+        }
+        match->seats[1] = self(id);
+        connections[id].matches.push_back(message.match);
+        answer.type = MessageType::Joined;
+        answer.seat = 2;
+        send(id, answer);
+        Message started;
+        started.type = MessageType::Started;
+        started.match = message.match;
+        deliver(match->seats[0], started);
+        deliver(match->seats[1], started);
+        match->lock.unlock();
+        return;
+    }
+
+    case MessageType::Play: {
+        Match *match = server.matches.find(message.match);
+        if (!match) {
+            refuse(static_cast<std::uint8_t>(ServerError::NoMatch));
+            return;
+        }
+        int seat = match->seats[0] == self(id) ? 0 : match->seats[1] == self(id) ? 1 : -1;
+        Action action = decodeAction(message.code);
+        // a code off the board would wrap onto another square
+        bool onBoard = message.code / 25 < BoardSquares && encodeAction(action) == message.code;
+        ActionResult result;
+        std::uint8_t reason = 0;
+        if (seat < 0) {
+            reason = static_cast<std::uint8_t>(ServerError::NotSeated);
+        } else if (match->seats[1].loop < 0) {
+            reason = static_cast<std::uint8_t>(ServerError::Waiting);
+        } else if (match->state.currentPlayer != seat + 1) {
+            reason = static_cast<std::uint8_t>(ServerError::NotYourTurn);
+        } else if (!onBoard) {
+            reason = static_cast<std::uint8_t>(ServerError::BadMessage);
+        } else if (!applyAction(match->state, action, &result)) {
+            reason = static_cast<std::uint8_t>(result.error);
+        }
+        if (reason) {
+            match->lock.unlock();
+            refuse(reason);
+            return;
+        }
+
+        // a side with no legal action left is a draw, as in the game
+        GameResult outcome = match->state.result;
+        if (outcome == GameResult::Ongoing) {
+            ActionList list;
+            generateActions(match->state, list);
+            if (list.size == 0) {
+                outcome = GameResult::Draw;
+            }
+        }
+        ++actions;
+        Message played;
+        played.type = MessageType::Played;
+        played.match = message.match;
+        played.ply = static_cast<std::uint16_t>(std::min(match->state.plyCount, 0xFFFF));
+        played.code = message.code;
+        played.result = static_cast<std::uint8_t>(outcome);
+        deliver(match->seats[0], played);
+        deliver(match->seats[1], played);
+        if (outcome != GameResult::Ongoing) {
+            server.matches.release(match);
+        } else {
+            match->lock.unlock();
+        }
+        return;
+    }
+
+    case MessageType::Leave:
+        leave(id, message.match);
+        return;
+
+    default:
+        refuse(static_cast<std::uint8_t>(ServerError::BadMessage));
+        return;
+    }
+}
+
+void Loop::leave(std::uint32_t id, std::uint32_t matchId)
+{
+    auto found = connections.find(id);
+    if (found != connections.end()) {
+        std::vector<std::uint32_t> &seated = found->second.matches;
+        seated.erase(std::remove(seated.begin(), seated.end(), matchId), seated.end());
+    }
+    Match *match = server.matches.find(matchId);
+    if (!match) {
+        return; // over already
+    }
+    int seat = match->seats[0] == self(id) ? 0 : match->seats[1] == self(id) ? 1 : -1;
+    if (seat < 0) {
+        match->lock.unlock();
+        return;
+    }
+    // the match ends with the seat that leaves it
+    Seat other = match->seats[1 - seat];
+    if (other.loop >= 0) {
+        Message left;
+        left.type = MessageType::Left;
+        left.match = matchId;
+        left.seat = static_cast<std::uint8_t>(seat + 1);
+        deliver(other, left);
+    }
+    server.matches.release(match);
+}
+
+void Loop::deliver(const Seat &seat, const Message &message)
+{
+    if (seat.loop == index) {
+        // what other loops posted for it before goes first
+        drainInbox();
+        send(seat.connection, message);
+    } else if (seat.loop >= 0) {
+        server.loops[seat.loop]->post(seat.connection, message);
+    }
+}
+
+void Loop::post(std::uint32_t connection, const Message &message)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> guard(inboxLock);
+        wasEmpty = inbox.empty();
+        inbox.push_back({connection, message});
+    }
+    if (wasEmpty) {
+        std::uint64_t one = 1;
+        ssize_t written = write(wake, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void Loop::drainInbox()
+{
+    std::vector<std::pair<std::uint32_t, Message>> messages;
+    {
+        std::lock_guard<std::mutex> guard(inboxLock);
+        messages.swap(inbox);
+    }
+    for (const auto &entry : messages) {
+        send(entry.first, entry.second);
+    }
+}
+
+void Loop::send(std::uint32_t id, const Message &message)
+{
+    auto found = connections.find(id);
+    if (found == connections.end()) {
+        return; // gone meanwhile
+    }
+    Connection &connection = found->second;
+    if (message.type == MessageType::Played && message.result != static_cast<std::uint8_t>(GameResult::Ongoing)) {
+        connection.matches.erase(std::remove(connection.matches.begin(), connection.matches.end(), message.match),
+                                 connection.matches.end());
+    } else if (message.type == MessageType::Left) {
+        connection.matches.erase(std::remove(connection.matches.begin(), connection.matches.end(), message.match),
+                                 connection.matches.end());
+    }
+    std::uint8_t frame[MaxFrameSize];
+    std::size_t size = encodeMessage(message, frame);
+    connection.out.insert(connection.out.end(), frame, frame + size);
+    if (!connection.dirty) {
+        connection.dirty = true;
+        dirty.push_back(id);
+    }
+}
+
+void Loop::flush(std::uint32_t id)
+{
+    auto found = connections.find(id);
+    if (found == connections.end()) {
+        return;
+    }
+    Connection &connection = found->second;
+    connection.dirty = false;
+    while (connection.sent < connection.out.size()) {
+        ssize_t written = ::send(connection.fd, connection.out.data() + connection.sent,
+                                 connection.out.size() - connection.sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            drop(id);
+            return;
+        }
+        connection.sent += static_cast<std::size_t>(written);
+    }
+    if (connection.sent == connection.out.size()) {
+        connection.out.clear();
+        connection.sent = 0;
+    } else if (connection.out.size() - connection.sent > (1u << 20)) {
+        drop(id); // a client that does not read
+        return;
+    }
+    bool wantWrite = connection.sent < connection.out.size();
+    if (wantWrite != connection.waitingToWrite) {
+        connection.waitingToWrite = wantWrite;
+        epoll_event event = {};
+        event.events = wantWrite ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u64 = id;
+        epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+}
+
+void Loop::drop(std::uint32_t id)
+{
+    auto found = connections.find(id);
+    if (found == connections.end()) {
+        return;
+    }
+    std::vector<std::uint32_t> seated = found->second.matches;
+    epoll_ctl(epoll, EPOLL_CTL_DEL, found->second.fd, nullptr);
+    close(found->second.fd);
+    connections.erase(found);
+    for (std::uint32_t matchId : seated) {
+        leave(id, matchId);
+    }
+}
+
+static int serve(int argc, char *argv[])
+{
+    std::vector<Endpoint> endpoints;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::size_t capacity = 65536;
+    for (int i = 2; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--tcp") == 0 && hasValue) {
+            Endpoint endpoint;
+            if (!parseTcp(argv[++i], endpoint)) {
+                std::fprintf(stderr, "bad port: %s\n", argv[i]);
+                return 2;
+            }
+            endpoints.push_back(endpoint);
+        } else if (std::strcmp(argv[i], "--unix") == 0 && hasValue) {
+            Endpoint endpoint;
+            endpoint.local = true;
+            endpoint.path = argv[++i];
+            endpoints.push_back(endpoint);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--matches") == 0 && hasValue) {
+            capacity = std::min<std::size_t>(std::max(1, std::atoi(argv[++i])), std::size_t(1) << MatchTable::SlotBits);
+        } else {
+            return -1;
+        }
+    }
+    if (endpoints.empty()) {
+        return -1;
+    }
+
+    std::vector<int> listeners;
+    for (const Endpoint &endpoint : endpoints) {
+        int fd = listenOn(endpoint);
+        if (fd < 0) {
+            return 1;
+        }
+        listeners.push_back(fd);
+        std::printf("listening on %s\n", endpoint.local ? endpoint.path.c_str()
+                                                       : (endpoint.host + ":" + endpoint.port).c_str());
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    Server server(threads, capacity);
+    std::printf("%d loops, room for %zu matches\n", threads, capacity);
+    std::fflush(stdout);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back([&server, &listeners, i]() { server.loops[i]->run(listeners); });
+    }
+    server.loops[0]->run(listeners);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::uint64_t actions = 0;
+    std::uint64_t accepted = 0;
+    for (const auto &loop : server.loops) {
+        actions += loop->actions;
+        accepted += loop->accepted;
+    }
+    std::printf("%.1f s: %llu connections, %llu matches, %llu actions (%.0f per second)\n", seconds,
+                static_cast<unsigned long long>(accepted),
+                static_cast<unsigned long long>(server.matches.totalCreated()),
+                static_cast<unsigned long long>(actions), seconds > 0 ? actions / seconds : 0.0);
+    for (int fd : listeners) {
+        close(fd);
+    }
+    for (const Endpoint &endpoint : endpoints) {
+        if (endpoint.local) {
+            unlink(endpoint.path.c_str());
+        }
+    }
+    return 0;
+}
+
+// ---- load generator
+
+struct LoadOptions {
+    Endpoint endpoint;
+    int matches = 100;
+    int games = 10;
+    int maxPlies = 300;
+    std::uint64_t seed = 1;
+};
+
+struct LoadStats {
+    std::uint64_t games = 0;
+    std::uint64_t finished = 0;     // ended by the rules, not left at the ply limit
+    std::uint64_t actions = 0;
+    std::uint64_t refused = 0;
+    std::vector<std::uint32_t> roundTrips; // microseconds, Play to Played on the mover's connection
+};
+
+// two connections playing one match after another against each other
+struct LoadPair {
+    int fds[2] = {-1, -1};          // seat 1, seat 2
+    std::vector<std::uint8_t> in[2];
+    std::uint32_t match = 0;
+    BoardState state;
+    int gamesLeft = 0;
+    bool done = false;
+    std::chrono::steady_clock::time_point sent;
+};
+
+static void sendMessage(int fd, const Message &message)
+{
+    // a few bytes into an almost empty socket buffer: one write is enough
+    std::uint8_t frame[MaxFrameSize];
+    std::size_t size = encodeMessage(message, frame);
+    ssize_t written = ::send(fd, frame, size, MSG_NOSIGNAL);
+    (void)written;
+}
+
+static void playRandom(LoadPair &pair, std::uint64_t &random)
+{
+    ActionList list;
+    generateActions(pair.state, list);
+    Message play;
+    play.type = MessageType::Play;
+    play.match = pair.match;
+    play.code = encodeAction(list[static_cast<int>(nextRandom(random) % static_cast<std::uint64_t>(list.size))]);
+    pair.sent = std::chrono::steady_clock::now();
+    sendMessage(pair.fds[pair.state.currentPlayer - 1], play);
+}
+
+static void startGame(LoadPair &pair)
+{
+    if (pair.gamesLeft-- <= 0) {
+        pair.done = true;
+        return;
+    }
+    Message create;
+    create.type = MessageType::Create;
+    sendMessage(pair.fds[0], create);
+}
+
+static void onLoadMessage(LoadPair &pair, int side, const Message &message, const LoadOptions &options,
+                          std::uint64_t &random, LoadStats &stats)
+{
+    switch (message.type) {
+    case MessageType::Joined:
+        if (side == 0) {
+            pair.match = message.match;
+            Message join;
+            join.type = MessageType::Join;
+            join.match = message.match;
+            sendMessage(pair.fds[1], join);
+        }
+        break;
+    case MessageType::Started:
+        if (side == 0) {
+            pair.state = initialBoardState();
+            playRandom(pair, random);
+        }
+        break;
+    case MessageType::Played: {
+        // the mover's copy advances the game, the opponent's copy is not needed
+        bool mover = side == pair.state.currentPlayer - 1 && message.ply == pair.state.plyCount + 1;
+        if (!mover || message.match != pair.match) {
+            break;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - pair.sent;
+        stats.roundTrips.push_back(static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        ++stats.actions;
+        applyAction(pair.state, decodeAction(message.code));
+        if (message.result != static_cast<std::uint8_t>(GameResult::Ongoing)) {
+            ++stats.games;
+            ++stats.finished;
+            startGame(pair);
+        } else if (pair.state.plyCount >= options.maxPlies) {
+            Message leave;
+            leave.type = MessageType::Leave;
+            leave.match = pair.match;
+            sendMessage(pair.fds[0], leave);
+            ++stats.games;
+            startGame(pair);
+        } else {
+            playRandom(pair, random);
+        }
+        break;
+    }
+    case MessageType::Refused:
+        std::fprintf(stderr, "match %u refused: reason %d\n", message.match, message.reason);
+        ++stats.refused;
+        pair.done = true;
+        break;
+    default:
+        break;
+    }
+}
+
+static void runLoad(const LoadOptions &options, int first, int count, LoadStats &stats)
+{
+    std::vector<LoadPair> pairs(static_cast<std::size_t>(count));
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    std::uint64_t random = options.seed * 0x9E3779B97F4A7C15ULL + static_cast<std::uint64_t>(first);
+    for (int i = 0; i < count; ++i) {
+        LoadPair &pair = pairs[i];
+        for (int side = 0; side < 2; ++side) {
+            pair.fds[side] = connectTo(options.endpoint);
+            if (pair.fds[side] < 0) {
+                std::fprintf(stderr, "cannot connect\n");
+                pair.done = true;
+                break;
+            }
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u64 = (static_cast<std::uint64_t>(i) << 1) | static_cast<std::uint64_t>(side);
+            epoll_ctl(epoll, EPOLL_CTL_ADD, pair.fds[side], &event);
+        }
+        pair.gamesLeft = options.games;
+        if (!pair.done) {
+            startGame(pair);
+        }
+    }
+
+    int active = static_cast<int>(std::count_if(pairs.begin(), pairs.end(), [](const LoadPair &p) { return !p.done; }));
+    epoll_event events[256];
+    std::uint8_t buffer[65536];
+    while (active > 0 && running) {
+        int ready = epoll_wait(epoll, events, 256, 1000);
+        for (int e = 0; e < ready; ++e) {
+            LoadPair &pair = pairs[events[e].data.u64 >> 1];
+            int side = static_cast<int>(events[e].data.u64 & 1);
+            if (pair.done) {
+                continue;
+            }
+            ssize_t got = read(pair.fds[side], buffer, sizeof(buffer));
+            if (got <= 0) {
+                if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    std::fprintf(stderr, "server closed a connection\n");
+                    pair.done = true;
+                    --active;
+                }
+                continue;
+            }
+            std::vector<std::uint8_t> &in = pair.in[side];
+            in.insert(in.end(), buffer, buffer + got);
+            std::size_t used = 0;
+            Message message;
+            int size;
+            while (!pair.done && (size = decodeMessage(in.data() + used, in.size() - used, message)) > 0) {
+                used += static_cast<std::size_t>(size);
+                onLoadMessage(pair, side, message, options, random, stats);
+            }
+            in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(used));
+            if (pair.done) {
+                --active;
+            }
+        }
+    }
+    for (LoadPair &pair : pairs) {
+        for (int fd : pair.fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+    close(epoll);
+}
+
+static int load(int argc, char *argv[])
+{
+    LoadOptions options;
+    bool haveEndpoint = false;
+    int threads = 1;
+    for (int i = 2; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--tcp") == 0 && hasValue) {
+            if (!parseTcp(argv[++i], options.endpoint)) {
+                std::fprintf(stderr, "bad port: %s\n", argv[i]);
+                return 2;
+            }
+            haveEndpoint = true;
+        } else if (std::strcmp(argv[i], "--unix") == 0 && hasValue) {
+            options.endpoint.local = true;
+            options.endpoint.path = argv[++i];
+            haveEndpoint = true;
+        } else if (std::strcmp(argv[i], "--matches") == 0 && hasValue) {
+            options.matches = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--games") == 0 && hasValue) {
+            options.games = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-plies") == 0 && hasValue) {
+            options.maxPlies = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return -1;
+        }
+    }
+    if (!haveEndpoint) {
+        return -1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    threads = std::min(threads, options.matches);
+    std::vector<LoadStats> stats(static_cast<std::size_t>(threads));
+    std::vector<std::thread> workers;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i) {
+        int first = options.matches * i / threads;
+        int count = options.matches * (i + 1) / threads - first;
+        workers.emplace_back([&options, &stats, i, first, count]() { runLoad(options, first, count, stats[i]); });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    LoadStats total;
+    for (LoadStats &part : stats) {
+        total.games += part.games;
+        total.finished += part.finished;
+        total.actions += part.actions;
+        total.refused += part.refused;
+        total.roundTrips.insert(total.roundTrips.end(), part.roundTrips.begin(), part.roundTrips.end());
+    }
+    std::sort(total.roundTrips.begin(), total.roundTrips.end());
+    auto percentile = [&](double p) {
+        return total.roundTrips.empty() ? 0u : total.roundTrips[static_cast<std::size_t>(p * (total.roundTrips.size() - 1))];
+    };
+    std::printf("%d matches, %llu games (%llu to the end), %llu actions in %.2f s: %.0f actions per second\n",
+                options.matches, static_cast<unsigned long long>(total.games),
+                static_cast<unsigned long long>(total.finished), static_cast<unsigned long long>(total.actions),
+                seconds, seconds > 0 ? total.actions / seconds : 0.0);
+    std::printf("round trip  p50 %u us  p90 %u us  p99 %u us  max %u us\n",
+                percentile(0.5), percentile(0.9), percentile(0.99), percentile(1.0));
+    if (total.refused) {
+        std::printf("%llu refused\n", static_cast<unsigned long long>(total.refused));
+        return 1;
+    }
+    return 0;
+}
+
+static int usage()
+{
+    std::fprintf(stderr, "usage: gameserver serve [--tcp [HOST:]PORT] [--unix PATH] [--threads N] [--matches N]\n"
+                         "       gameserver load (--tcp [HOST:]PORT | --unix PATH) [--matches N] [--games G]\n"
+                         "                       [--threads N] [--max-plies P] [--seed S]\n");
+    return 2;
+}
+
+int main(int argc, char *argv[])
+{
+    int status = -1;
+    if (argc > 1 && std::strcmp(argv[1], "serve") == 0) {
+        status = serve(argc, argv);
+    } else if (argc > 1 && std::strcmp(argv[1], "load") == 0) {
+        status = load(argc, argv);
+    }
+    return status < 0 ? usage() : status;
+}
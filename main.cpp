@@ -6,7 +6,9 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+    // ChessGame [scenario]: start from a .cgs or text scenario
+    QStringList arguments = a.arguments();
+    MainWindow w(nullptr, arguments.size() > 1 ? arguments.at(1) : QString());
     w.show();
     return a.exec();
 }
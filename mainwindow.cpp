@@ -2,97 +2,81 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "terrain.h"
-#include <QGraphicsRectItem>
+#include "movement.h"
+#include "scenario.h"
 #include <QGraphicsEllipseItem>
+#include <QGraphicsRectItem>
 #include <QMouseEvent>
 #include <QMessageBox>
 #include <QBrush>
 #include <QPen>
 #include <QDebug>
 #include <QTimer>
-
-
-void checkForVictory(QGraphicsScene *scene,QString & eatMessage, bool & gameOver) {
-    if(gameOver) return;
-    for (auto item : scene->items()) {
-        Piece *piece = dynamic_cast<Piece*>(item);
-        if (piece && dynamic_cast<King*>(piece) ) {
-            if (piece->isKingCaptured(scene)) {
-                if (piece->isPlayerOne) {
-                    if(gameOver){
-                        return;
-                    }
-
-                    eatMessage +=  "Player 1 wins! ";
-                } else {
-                    if(gameOver){
-                        return;
-                    }
-                    eatMessage +=  "Player 2 wins! ";
-                }
-            }
-            gameOver = true;
-            break;
-        }
-    }
-}
-
-void checkForVictory(QGraphicsScene *scene, bool & gameOver,QString & bombMessage) {
-    if(gameOver) return;
-    for (auto item : scene->items()) {
-        Piece *piece = dynamic_cast<Piece*>(item);
-        if (piece && dynamic_cast<King*>(piece)) {
-            if (piece->isKingCaptured(scene)) {
-                if (piece->isPlayerOne) {
-                    if(gameOver){
-                        return;
-                    }
-                    bombMessage += "Player 1 wins!";
-                } else {
-                    if(gameOver){
-                        return;
-                    }
-                    bombMessage += "Player 2 wins!";
-                }
-            }
-            gameOver = true;
-        }
+#include <QStatusBar>
+#include <QMenu>
+#include <QMenuBar>
+#include <QActionGroup>
+#include <QKeySequence>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QThread>
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <algorithm>
+
+
+// error message of a refused move or ability
+static QString ruleErrorText(RuleError error)
+{
+    switch (error) {
+    case RuleError::MountainLimit:   return "Can only move 1 horizontally or perpendicularly in the mountains!";
+    case RuleError::ForestLimit:     return "Can only move 2 in the forest!";
+    case RuleError::BombRiver:       return "Bomb cannot cross the river!";
+    case RuleError::QueenRiver:      return "Queen cannot cross the river!";
+    case RuleError::KingRiver:       return "King cannot cross the river!";
+    case RuleError::BishopRiver:     return "Bishop cannot cross the river!";
+    case RuleError::JumpOverPiece:   return "Cannot go over pieces";
+    case RuleError::OwnPiece:        return "Cannot eat self-piece!";
+    case RuleError::DesertCapture:   return "Cannot eat in the desert";
+    case RuleError::NoAbility:       return "This piece has no special ability.";
+    case RuleError::AbilityUsed:     return "The special ability is already used";
+    case RuleError::NoKnight:        return "Cannot find the knight!";
+    case RuleError::SpawnOutside:    return "Cannot spawn outside the board";
+    case RuleError::SpawnOnOwnPiece: return "Cannot spawn upon your own piece!";
+    case RuleError::NoEffect:        return "The special ability would not change anything";
+    case RuleError::GameOver:        return "Have Fun!";
+    default:                         return "Invalid move!";
     }
 }
 
-Piece *MainWindow::FindPieceAtXY(int x, int y, QGraphicsScene *scene){
-    Piece *piece = nullptr;
-    for (auto item : scene->items()) {
-        piece = dynamic_cast<Piece*>(item);
-        if(piece) {
-            if (piece && piece->x == x && piece->y == y ) {
-                return piece;
-            }
-        }
-    }
-    return piece;
+const Piece *MainWindow::FindPieceAtXY(int x, int y) const {
+    return BoardState::inside(x, y) ? piecePool.get(pieceGrid[BoardState::index(x, y)]) : nullptr;
 }
 
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(QWidget *parent, const QString &scenarioPath)
     : QMainWindow(parent)
     , gameOver(false)
     , ui(new Ui::MainWindow)
     , currentPlayer(1)
-    , selectedPiece(nullptr)
-    , terrain(11, 11)
+    , terrain(BoardRows, BoardCols)
 
 {
     // initialization
     ui->setupUi(this);
+    player1Pieces.reserve(BoardSquares);
+    player2Pieces.reserve(BoardSquares);
 
     terrain.setupTerrain();
-
-    scene = new QGraphicsScene(0,0,701,701,this);
+    bool fromScenario = !scenarioPath.isEmpty() && loadScenario(scenarioPath);
 
     setupGameBoard();
 
-    addPieces();
+    if (fromScenario) {
+        syncPieces();
+    } else {
+        addPieces();
+    }
 
     ui->graphicsView->setScene(scene);
     ui->graphicsView->setRenderHint(QPainter::Antialiasing);
@@ -101,6 +85,10 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowTitle(QString("Chess Game - PLAYER %1 's Turn").arg(currentPlayer));
 
     ui->graphicsView->installEventFilter(this);
+
+    addGameMenu();
+    addComputerMenu();
+    addNetworkMenu();
 }
 
 MainWindow::~MainWindow()
@@ -108,66 +96,6 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-void MainWindow::addLegend()
-{
-    const int legendX = 600;
-    const int legendY = 20;
-    const int rectSize = 20;
-    const int spacing = 10;
-    const int textOffset = 25;
-
-    struct LegendItem {
-        QColor color;
-        QString description;
-    };
-
-    // legends of the terrain
-    std::vector<LegendItem> terrainLegend = {
-        {QColor(34, 139, 34), "Forest"},
-        {QColor(30, 144, 255), "River"},
-        {QColor(165, 42, 42), "Mountain"},
-        {QColor(210, 180, 140), "Desert"},
-    };
-
-    // piece's legends
-    std::vector<LegendItem> pieceLegend = {
-        {QColor(0, 0, 255), "Knight"},
-        {QColor(255, 0, 0), "Bomb"},
-        {QColor(0, 255, 0), "Pawn"},
-        {QColor(204, 0, 204), "Queen"},
-        {QColor(255, 255, 0), "King"},
-        {QColor(51, 255, 255), "Bishop"},
-    };
-
-    int y = legendY;
-    scene->addText("Terrain Legend:")->setPos(legendX, y);
-    y += rectSize + spacing;
-    for (const auto &item : terrainLegend) {
-        QGraphicsRectItem *rect = scene->addRect(
-            legendX, y, rectSize, rectSize, QPen(Qt::black), QBrush(item.color));
-        rect->setZValue(0);
-
-        QGraphicsTextItem *text = scene->addText(item.description);
-        text->setDefaultTextColor(Qt::black);
-        text->setPos(legendX + textOffset, y - 5);
-        y += rectSize + spacing;
-    }
-
-    y += spacing;
-    scene->addText("Piece Legend:")->setPos(legendX, y);
-    y += rectSize + spacing;
-    for (const auto &item : pieceLegend) {
-        QGraphicsRectItem *rect = scene->addRect(
-            legendX, y, rectSize, rectSize, QPen(Qt::black), QBrush(item.color));
-        rect->setZValue(0);
-
-        QGraphicsTextItem *text = scene->addText(item.description);
-        text->setDefaultTextColor(Qt::black);
-        text->setPos(legendX + textOffset, y - 5);
-        y += rectSize + spacing;
-    }
-}
-
 TerrainType MainWindow::getTerrain(int x, int y)
 {
     return terrain.getTerrain(x, y);
@@ -175,81 +103,618 @@ TerrainType MainWindow::getTerrain(int x, int y)
 
 
 void MainWindow::setupGameBoard() {
-    const int cellSize = 50;
+    const int cellSize = BoardScene::CellSize;
 
-    // draw the board
-    for (int row = 0; row < terrain.getRows(); ++row) {
-        for (int col = 0; col < terrain.getCols(); ++col) {
-            QColor color;
-            switch (terrain.getTerrain(row, col)) {
-            case TerrainType::Land:
-                color = (row + col) % 2 == 0 ? QColor(255, 255, 255) : QColor(200, 200, 200);
-                break;
-            case TerrainType::Forest:
-                color = QColor(34, 139, 34);
-                break;
-            case TerrainType::River:
-                color = QColor(30, 144, 255);
-                break;
-            case TerrainType::Mountain:
-                color = QColor(165, 42, 42);
-                break;
-            case TerrainType::Desert:
-                color = QColor(210, 180, 140);
+    // the terrain and the legend are the scene's background, drawn once
+    scene = new BoardScene(terrain, this);
+    ui->graphicsView->setCacheMode(QGraphicsView::CacheBackground);
+
+    ui->graphicsView->setSceneRect(0, 0, terrain.getCols() * cellSize, terrain.getRows() * cellSize);
+    ui->graphicsView->centerOn(terrain.getCols() * cellSize / 2, terrain.getRows() * cellSize / 2);
+}
+
+void MainWindow::addPieces()
+{
+    // PlayerOne: upwards, PlayerTwo: downwards
+    state = BoardState(terrain);
+    addStandardPieces(state);
+    startState = state;
+    syncPieces();
+}
+
+bool MainWindow::loadScenario(const QString &path)
+{
+    std::string file = path.toStdString();
+    GameRecord record;
+    BoardState loaded;
+    std::string error;
+    bool read = isRecordFile(file) ? loadRecordFile(file, record, &error) : loadScenarioFile(file, record.start, &error);
+    if (!read || !scenarioToState(record.start, loaded, &error)) {
+        QMessageBox::warning(this, "Scenario", QString("%1: %2\nStarting the standard game.")
+                             .arg(path, QString::fromStdString(error)));
+        return false;
+    }
+    terrain = scenarioTerrain(record.start);
+    state = loaded;
+    startState = loaded;
+
+    // a record is played to its end, every action of it can be taken back
+    for (const Action &action : record.actions) {
+        PlayedAction played = {action, UndoRecord()};
+        std::uint64_t key = state.hash;
+        if (!makeAction(state, action, played.undo)) {
+            QMessageBox::warning(this, "Game record", QString("%1: action %2 (%3) is not legal, the game stops before it.")
+                                 .arg(path).arg(static_cast<int>(history.size()) + 1).arg(QString::fromStdString(actionNotation(action))));
+            break;
+        }
+        playedKeys.push_back(key);
+        history.push_back(played);
+    }
+    currentPlayer = state.currentPlayer;
+    gameOver = state.result != GameResult::Ongoing;
+    return true;
+}
+
+void MainWindow::syncPieces()
+{
+    targetsReady = false; // a new state, maybe on another terrain the hash knows nothing of
+    for (int sq = 0; sq < BoardSquares; ++sq) {
+        if (pieceGrid[sq].valid()) {
+            removePieceItem(pieceGrid[sq]);
+            pieceGrid[sq] = PieceHandle();
+        }
+        if (state.squares[sq].type != PieceType::None) {
+            addPieceItem(sq);
+        }
+    }
+}
+
+void MainWindow::addPieceItem(int sq)
+{
+    const PieceState &square = state.squares[sq];
+    PieceHandle handle = piecePool.acquire(); // never full, at most one piece per square
+    piecePool.get(handle)->setup(square.type, sq % BoardCols, sq / BoardCols, square.isPlayerOne, scene);
+    pieceGrid[sq] = handle;
+    (square.isPlayerOne ? player1Pieces : player2Pieces).push_back(handle);
+}
+
+void MainWindow::removePieceItem(PieceHandle handle)
+{
+    Piece *piece = piecePool.get(handle);
+    std::vector<PieceHandle> &owned = piece->isPlayerOne ? player1Pieces : player2Pieces;
+    owned.erase(std::find(owned.begin(), owned.end(), handle));
+    piece->hide(); // kept in the scene for its next piece
+    piecePool.release(handle);
+}
+
+// only the squares an action changed are touched: a piece that left one square and
+// shows up on another (move, charge, swap) keeps its item, the rest are captures and spawns
+void MainWindow::updatePieces(const BoardState &before)
+{
+    targetsReady = false;
+    PieceHandle left[BoardSquares];
+    int leftCount = 0;
+    int arrived[BoardSquares];
+    int arrivedCount = 0;
+
+    for (int sq = 0; sq < BoardSquares; ++sq) {
+        const PieceState &old = before.squares[sq];
+        const PieceState &now = state.squares[sq];
+        if (old.type == now.type && old.isPlayerOne == now.isPlayerOne) {
+            continue;
+        }
+        if (old.type != PieceType::None) {
+            left[leftCount++] = pieceGrid[sq];
+            pieceGrid[sq] = PieceHandle();
+        }
+        if (now.type != PieceType::None) {
+            arrived[arrivedCount++] = sq;
+        }
+    }
+
+    for (int i = 0; i < arrivedCount; ++i) {
+        int sq = arrived[i];
+        const PieceState &now = state.squares[sq];
+        int match = 0;
+        for (; match < leftCount; ++match) {
+            const Piece *piece = piecePool.get(left[match]);
+            if (piece && piece->type == now.type && piece->isPlayerOne == now.isPlayerOne) {
                 break;
             }
-            QGraphicsRectItem *cell = scene->addRect(col * cellSize, row * cellSize, cellSize, cellSize,
-                                                     QPen(Qt::black), QBrush(color));
-            cell->setZValue(-1);
+        }
+        if (match < leftCount) {
+            piecePool.get(left[match])->moveTo(sq % BoardCols, sq / BoardCols);
+            pieceGrid[sq] = left[match];
+            left[match] = PieceHandle();
+        } else {
+            addPieceItem(sq);
         }
     }
 
-    ui->graphicsView->setSceneRect(0, 0, terrain.getCols() * cellSize, terrain.getRows() * cellSize);
-    ui->graphicsView->centerOn(terrain.getCols() * cellSize / 2, terrain.getRows() * cellSize / 2);
+    for (int i = 0; i < leftCount; ++i) {
+        if (left[i].valid()) {
+            removePieceItem(left[i]);
+        }
+    }
+}
+
+bool MainWindow::announceResult()
+{
+    switch (state.result) {
+    case GameResult::PlayerOneWins:
+        QMessageBox::information(this, "WIN!!!", "Player1 win！");
+        break;
+    case GameResult::PlayerTwoWins:
+        QMessageBox::information(this, "WIN!!!", "Player2 win！");
+        break;
+    case GameResult::Draw:
+        QMessageBox::information(this, "DRAW!!!", "Both players are out!");
+        break;
+    default: {
+        // nobody can be captured any more when the player to move is stuck
+        ActionList list;
+        generateActions(state, list);
+        if (list.size > 0) {
+            return false;
+        }
+        QMessageBox::information(this, "DRAW!!!", QString("Player%1 cannot move!").arg(currentPlayer));
+        break;
+    }
+    }
+    gameOver = true;
+    return true;
+}
+
+bool MainWindow::playAction(const Action &action, RuleError &error)
+{
+    ActionResult outcome;
+    BoardState before = state;
+    PlayedAction played = {action, UndoRecord()};
+    if (!makeAction(state, action, played.undo, &outcome)) {
+        error = outcome.error;
+        return false;
+    }
+    error = RuleError::None;
+    stopEngine(); // an analysis of the position before
+    playedKeys.push_back(before.hash);
+    history.push_back(played);
+    recordWriter.write(action);
+    // replaying the action taken back keeps the rest of the redo line
+    if (!redoActions.empty() && redoActions.back() == action) {
+        redoActions.pop_back();
+    } else {
+        redoActions.clear();
+    }
+    selectPiece(PieceHandle());
+    updatePieces(before);
+
+    QString message;
+    QString actor = pieceTypeName(outcome.actor);
+    QString victim = pieceTypeName(outcome.captured);
+    if (action.isAbility) {
+        switch (outcome.actor) {
+        case PieceType::Bomb:
+            message = "\nBomb exploded!";
+            break;
+        case PieceType::Knight:
+            message = "\nKnight used Charge!";
+            break;
+        case PieceType::Queen:
+            message = "\nQueen used Royal Command!";
+            break;
+        case PieceType::King:
+            message = "\nKing used Divine Protection!";
+            break;
+        case PieceType::Bishop:
+            message = QStringLiteral("\nBishop used Holy Light!（Left:%1）")
+                          .arg(state.squares[action.from].abilityUsesLeft);
+            break;
+        default:
+            break;
+        }
+    } else if (outcome.captured != PieceType::None) {
+        // eating message
+        message = actor + " ate " + victim + ". ";
+        if (outcome.actor == PieceType::Bomb && outcome.captured == PieceType::Bomb) {
+            message = "Two Bombs exploded!";
+        } else if (outcome.actor == PieceType::Bomb) {
+            message = "Bomb exploded! AND " + victim + " died!";
+        } else if (outcome.captured == PieceType::Bomb) {
+            message = actor + " encountered BOMB and exploded!";
+        }
+    }
+    if (!message.isEmpty()) {
+        showCaptureMessage(message);
+    }
 
+    if (!announceResult()) {
+        switchPlayer();
+    }
+    return true;
+}
 
-    addLegend();
+void MainWindow::addGameMenu()
+{
+    QMenu *menu = menuBar()->addMenu("Game");
+    QAction *undo = menu->addAction("Undo");
+    undo->setShortcut(QKeySequence::Undo);
+    connect(undo, &QAction::triggered, this, &MainWindow::undoAction);
+    QAction *redo = menu->addAction("Redo");
+    redo->setShortcut(QKeySequence::Redo);
+    connect(redo, &QAction::triggered, this, &MainWindow::redoAction);
+    menu->addSeparator();
+    QAction *record = menu->addAction("Record game...");
+    connect(record, &QAction::triggered, this, &MainWindow::recordGame);
 }
 
-void MainWindow::addPieces()
+void MainWindow::recordGame()
 {
-    // PlayerOne: upwards
-    player1Pieces.push_back(new Pawn(0, 0, true, scene));
-    player1Pieces.push_back(new Pawn(1, 0, true, scene));
-    player1Pieces.push_back(new Knight(2, 0, true, scene));
-    player1Pieces.push_back(new Bishop(3, 0, true, scene));
-    player1Pieces.push_back(new Queen(4, 0, true, scene));
-    player1Pieces.push_back(new King(5, 0, true, scene));
-    player1Pieces.push_back(new Bomb(6, 0, true, scene));
-    player1Pieces.push_back(new Bishop(7, 0, true, scene));
-    player1Pieces.push_back(new Knight(8, 0, true, scene));
-    player1Pieces.push_back(new Pawn(9, 0, true, scene));
-    player1Pieces.push_back(new Pawn(10, 0, true, scene));
-
-    //PlayerTwo: downwards
-    player2Pieces.push_back(new Pawn(0, 10, false, scene));
-    player2Pieces.push_back(new Pawn(1, 10, false, scene));
-    player2Pieces.push_back(new Knight(2, 10, false, scene));
-    player2Pieces.push_back(new Bishop(3, 10, false, scene));
-    player2Pieces.push_back(new Queen(4, 10, false, scene));
-    player2Pieces.push_back(new King(5, 10, false, scene));
-    player2Pieces.push_back(new Bomb(6, 10, false, scene));
-    player2Pieces.push_back(new Bishop(7, 10, false, scene));
-    player2Pieces.push_back(new Knight(8, 10, false, scene));
-    player2Pieces.push_back(new Pawn(9, 10, false, scene));
-    player2Pieces.push_back(new Pawn(10, 10, false, scene));
+    QString path = QFileDialog::getSaveFileName(this, "Record game", QString(), "Game records (*.cgr)");
+    if (path.isEmpty()) {
+        return;
+    }
+    std::string error;
+    if (!recordWriter.open(path.toStdString(), startState, &error)) {
+        QMessageBox::warning(this, "Record game", QString::fromStdString(error));
+        return;
+    }
+    // the game so far, then every action as it is played
+    for (const PlayedAction &played : history) {
+        recordWriter.write(played.action);
+    }
 }
 
-void MainWindow::switchPlayer()
+void MainWindow::undoAction()
 {
-    currentPlayer = (currentPlayer == 1) ? 2 : 1;
+    if (netMatch) {
+        return; // the server keeps the game
+    }
+    stopEngine();
+    // the computer's reply is taken back with the move it answered
+    do {
+        if (history.empty()) {
+            break;
+        }
+        BoardState before = state;
+        takeBack(state, history.back().undo);
+        redoActions.push_back(history.back().action);
+        history.pop_back();
+        playedKeys.pop_back();
+        updatePieces(before);
+    } while (state.currentPlayer == computerPlayer);
+    std::string error;
+    if (!recordWriter.truncate(static_cast<int>(history.size()), &error)) {
+        QMessageBox::warning(this, "Record game", QString::fromStdString(error) + "\nThe game is no longer recorded.");
+    }
+
+    gameOver = false;
+    selectPiece(PieceHandle());
+    currentPlayer = state.currentPlayer;
     setWindowTitle(QString("Chess Game - Player %1 's Turn").arg(currentPlayer));
+    startEngine(); // the computer only moves when the whole game was taken back
+}
 
+void MainWindow::redoAction()
+{
+    if (netMatch) {
+        return;
+    }
+    RuleError error;
+    while (!gameOver && !redoActions.empty()) {
+        if (!playAction(redoActions.back(), error)) {
+            redoActions.clear(); // not from this position
+            break;
+        }
+        if (currentPlayer != computerPlayer) {
+            break;
+        }
+    }
+}
+
+void MainWindow::addComputerMenu()
+{
+    engineHost.setThreads(std::max(1, QThread::idealThreadCount()));
+    connect(&engineHost, &EngineHost::progress, this, &MainWindow::onEngineProgress);
+    connect(&engineHost, &EngineHost::finished, this, &MainWindow::onEngineFinished);
+
+    QMenu *menu = menuBar()->addMenu("Computer");
+    QActionGroup *group = new QActionGroup(this);
+    playerChoices = group;
+    const QStringList labels = {"Two players", "Computer plays Player 1", "Computer plays Player 2"};
+    for (int player = 0; player < labels.size(); ++player) {
+        QAction *choice = menu->addAction(labels[player]);
+        choice->setCheckable(true);
+        choice->setChecked(player == computerPlayer);
+        group->addAction(choice);
+        connect(choice, &QAction::triggered, this, [this, player]() {
+            computerPlayer = player;
+            selectPiece(PieceHandle());
+            stopEngine();
+            startEngine();
+        });
+    }
 
-    for (auto item : scene->items()) {
-        Piece *piece = dynamic_cast<Piece*>(item);
+    menu->addSeparator();
+    QAction *monteCarlo = menu->addAction("Monte Carlo search");
+    monteCarlo->setCheckable(true);
+    connect(monteCarlo, &QAction::toggled, this, [this](bool checked) { engineHost.setUseMcts(checked); });
+
+    QAction *analysis = menu->addAction("Analyse position");
+    analysis->setCheckable(true);
+    connect(analysis, &QAction::toggled, this, [this](bool checked) {
+        analysing = checked;
+        if (!checked && analysisJob) {
+            engineHost.stop();
+            analysisJob = 0;
+            statusBar()->clearMessage();
+        }
+        startEngine();
+    });
 
+    // book.cgb next to the program, a different choice among its actions every game
+    QAction *useBook = menu->addAction("Opening book");
+    useBook->setCheckable(true);
+    bool haveBook = book.open((QCoreApplication::applicationDirPath() + "/book.cgb").toStdString());
+    useBook->setEnabled(haveBook);
+    useBook->setChecked(haveBook);
+    connect(useBook, &QAction::toggled, this, [this](bool checked) {
+        std::uint64_t seed = QRandomGenerator::global()->generate64();
+        engineHost.setBook(checked ? &book : nullptr, seed);
+    });
+    if (haveBook) {
+        std::uint64_t seed = QRandomGenerator::global()->generate64();
+        engineHost.setBook(&book, seed);
     }
+
+    // the tablebases directory next to the program
+    if (tablebases.open((QCoreApplication::applicationDirPath() + "/tablebases").toStdString())
+        && tablebases.tableCount() > 0) {
+        engineHost.setTablebases(&tablebases);
+    }
+}
+
+void MainWindow::startEngine()
+{
+    if (gameOver || engineJob || analysisJob) {
+        return;
+    }
+    // the engine thread gets a copy of the position, the board stays responsive
+    if (computerPlayer == currentPlayer) {
+        engineJob = engineHost.think(state, playedKeys);
+        statusBar()->showMessage("Thinking...");
+    } else if (analysing) {
+        analysisJob = engineHost.analyse(state, playedKeys);
+    }
+}
+
+void MainWindow::stopEngine()
+{
+    if (engineJob || analysisJob) {
+        engineHost.stop();
+        engineJob = 0;
+        analysisJob = 0;
+        statusBar()->clearMessage();
+    }
+}
+
+void MainWindow::onEngineProgress(quint64 job, const QString &text)
+{
+    if (job && (job == engineJob || job == analysisJob)) {
+        statusBar()->showMessage(text);
+    }
+}
+
+void MainWindow::onEngineFinished(quint64 job, bool found, Action best)
+{
+    if (job && job == analysisJob) {
+        analysisJob = 0; // a forced result, nothing more to find
+        return;
+    }
+    if (!job || job != engineJob) {
+        return; // dropped by stopEngine()
+    }
+    engineJob = 0;
+    statusBar()->clearMessage();
+    RuleError error;
+    if (found && !gameOver && computerPlayer == currentPlayer) {
+        playAction(best, error);
+    }
+}
+
+void MainWindow::addNetworkMenu()
+{
+    connect(&net, &NetClient::connected, this, [this]() { net.send(netRequest); });
+    connect(&net, &NetClient::received, this, &MainWindow::onNetMessage);
+    connect(&net, &NetClient::failed, this, &MainWindow::onNetFailed);
+
+    QMenu *menu = menuBar()->addMenu("Network");
+    QAction *host = menu->addAction("Host match...");
+    connect(host, &QAction::triggered, this, [this]() {
+        Message create;
+        create.type = MessageType::Create;
+        requestMatch(create);
+    });
+    QAction *join = menu->addAction("Join match...");
+    connect(join, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        QString number = QInputDialog::getText(this, "Join match", "Match number:", QLineEdit::Normal, QString(), &ok);
+        if (!ok || number.toUInt() == 0) {
+            return;
+        }
+        Message joinMatch;
+        joinMatch.type = MessageType::Join;
+        joinMatch.match = number.toUInt();
+        requestMatch(joinMatch);
+    });
+    QAction *leave = menu->addAction("Leave match");
+    connect(leave, &QAction::triggered, this, &MainWindow::leaveMatch);
+}
+
+void MainWindow::requestMatch(const Message &request)
+{
+    // HOST:PORT, or the path of the server's Unix socket
+    bool ok = false;
+    QString address = QInputDialog::getText(this, "Game server", "Server address:", QLineEdit::Normal, serverAddress, &ok);
+    if (!ok || address.isEmpty()) {
+        return;
+    }
+    leaveMatch();
+    serverAddress = address;
+    netRequest = request;
+    net.connectTo(address);
+    statusBar()->showMessage("Connecting to " + address + "...");
+}
+
+void MainWindow::leaveMatch()
+{
+    if (netMatch) {
+        Message leave;
+        leave.type = MessageType::Leave;
+        leave.match = netMatch;
+        net.send(leave);
+    }
+    net.disconnectFrom();
+    endNetworkMatch();
+}
+
+void MainWindow::endNetworkMatch()
+{
+    netMatch = 0;
+    netSeat = 0;
+    netStarted = false;
+    playerChoices->setEnabled(true);
+}
+
+void MainWindow::onNetMessage(const Message &message)
+{
+    switch (message.type) {
+    case MessageType::Joined:
+        // a new game on the standard board; the engine is off, the other window is the opponent
+        computerPlayer = 0;
+        playerChoices->actions().first()->setChecked(true);
+        playerChoices->setEnabled(false);
+        newGame();
+        netMatch = message.match;
+        netSeat = message.seat;
+        statusBar()->showMessage(netSeat == 1 ? QString("Match %1: waiting for an opponent to join").arg(netMatch)
+                                              : QString("Match %1 joined").arg(netMatch));
+        break;
+    case MessageType::Started:
+        if (message.match == netMatch) {
+            netStarted = true;
+            statusBar()->showMessage(QString("Match %1: you are Player %2").arg(netMatch).arg(netSeat));
+        }
+        break;
+    case MessageType::Played: {
+        if (message.match != netMatch) {
+            break;
+        }
+        // both windows play the actions in the order the server took them
+        RuleError error;
+        if (!playAction(decodeAction(message.code), error)) {
+            QMessageBox::warning(this, "Network match", "The server played an action this board refuses; leaving the match.");
+            leaveMatch();
+        } else if (message.result != static_cast<std::uint8_t>(GameResult::Ongoing) || gameOver) {
+            net.disconnectFrom(); // the server ended the match with the game
+            endNetworkMatch();
+        }
+        break;
+    }
+    case MessageType::Left:
+        if (message.match == netMatch) {
+            net.disconnectFrom();
+            endNetworkMatch();
+            gameOver = true;
+            QMessageBox::information(this, "Network match", QString("Player %1 left the match.").arg(message.seat));
+        }
+        break;
+    case MessageType::Refused: {
+        std::uint8_t reason = message.reason;
+        QString text;
+        switch (static_cast<ServerError>(reason)) {
+        case ServerError::NoMatch:     text = "There is no such match."; break;
+        case ServerError::MatchFull:   text = "The match has two players already."; break;
+        case ServerError::ServerFull:  text = "The server has no room for another match."; break;
+        case ServerError::NotYourTurn: text = "The other player's turn"; break;
+        case ServerError::Waiting:     text = "Waiting for an opponent"; break;
+        case ServerError::StillWaiting: text = "Your last match is still waiting for an opponent."; break;
+        default:
+            text = reason < static_cast<std::uint8_t>(ServerError::NoMatch) ? ruleErrorText(static_cast<RuleError>(reason))
+                                                                            : QString("Refused by the server");
+            break;
+        }
+        if (!netMatch) {
+            // the match could not be hosted or joined
+            net.disconnectFrom();
+            QMessageBox::warning(this, "Network match", text);
+        } else {
+            statusBar()->showMessage(text, 3000);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void MainWindow::onNetFailed(const QString &error)
+{
+    bool inMatch = netMatch != 0;
+    endNetworkMatch();
+    statusBar()->clearMessage();
+    QMessageBox::warning(this, "Network match", inMatch ? "The match ended: " + error : error);
+}
+
+void MainWindow::newGame()
+{
+    stopEngine();
+    recordWriter.close();
+    history.clear();
+    redoActions.clear();
+    playedKeys.clear();
+    // the background is only painted again when a scenario changed the terrain
+    bool repaint = false;
+    for (int sq = 0; sq < BoardSquares && !repaint; ++sq) {
+        repaint = terrain.at(sq) != defaultTerrain.at(sq);
+    }
+    terrain = defaultTerrain;
+    if (repaint) {
+        scene->setTerrain(terrain);
+    }
+    addPieces();
+    gameOver = false;
+    currentPlayer = state.currentPlayer;
+    selectPiece(PieceHandle());
+    setWindowTitle(QString("Chess Game - Player %1 's Turn").arg(currentPlayer));
+}
+
+bool MainWindow::submitAction(const Action &action, RuleError &error)
+{
+    if (!netMatch) {
+        return playAction(action, error);
+    }
+    // checked here for the message at once, played when the server sends it back
+    BoardState copy = state;
+    ActionResult outcome;
+    if (!applyAction(copy, action, &outcome)) {
+        error = outcome.error;
+        return false;
+    }
+    error = RuleError::None;
+    Message play;
+    play.type = MessageType::Play;
+    play.match = netMatch;
+    play.code = encodeAction(action);
+    net.send(play);
+    return true;
+}
+
+void MainWindow::switchPlayer()
+{
+    currentPlayer = (currentPlayer == 1) ? 2 : 1;
+    setWindowTitle(QString("Chess Game - Player %1 's Turn").arg(currentPlayer));
+
+    startEngine();
 }
 
 void MainWindow::showCaptureMessage(QString &message)
@@ -265,12 +730,8 @@ void MainWindow::showCaptureMessage(QString &message)
 
     scene->addItem(textItem);
 
-    QTimer::singleShot(3000, [textItem, this]() {
-        if (scene->items().contains(textItem)) {
-            scene->removeItem(textItem);
-            delete textItem;
-        }
-    });
+    // the item lives as long as the window and its scene, deleting takes it off
+    QTimer::singleShot(3000, this, [textItem]() { delete textItem; });
 }
 
 bool MainWindow::eventFilter(QObject *obj, QEvent *event)
@@ -284,108 +745,38 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
             onGraphicsViewClicked(point);
             return true;
         } if (mouseEvent->button() == Qt::RightButton) {
-            if (selectedPiece) {
-                QString pieceType;
-                if (dynamic_cast<Knight*>(selectedPiece)) {
-                    pieceType = "Knight";
-                } else if (dynamic_cast<Pawn*>(selectedPiece)) {
-                    pieceType = "Pawn";
-                } else if (dynamic_cast<Queen*>(selectedPiece)) {
-                    pieceType = "Queen";
-                } else if (dynamic_cast<King*>(selectedPiece)) {
-                    pieceType = "King";
-                } else if (dynamic_cast<Bishop*>(selectedPiece)) {
-                    pieceType = "Bishop";
-                } else if (dynamic_cast<Bomb*>(selectedPiece)) {
-                    pieceType = "Bomb";
-                }
-
+            if (const Piece *selected = piecePool.get(selectedPiece)) {
                 // showcase the info.
                 QString message = QString("Piece type: %1\nSpecial ability: %2")
-                                      .arg(pieceType)
-                                      .arg(QString::fromStdString(selectedPiece->getSpecialAbilityText()));
+                                      .arg(pieceTypeName(selected->type))
+                                      .arg(QString::fromStdString(selected->getSpecialAbilityText()));
+                int sq = BoardState::index(selected->x, selected->y);
+                QString name = selected->name;
                 QMessageBox::information(this, "Piece information", message);
 
                 // checking whether have special ability
-                bool hasAbility = (dynamic_cast<Knight*>(selectedPiece) ||
-                                  dynamic_cast<Queen*>(selectedPiece) ||
-                                  dynamic_cast<King*>(selectedPiece) ||
-                                  dynamic_cast<Bishop*>(selectedPiece) ||
-                                  dynamic_cast<Bomb*>(selectedPiece));
+                bool hasAbility = hasSpecialAbility(selected->type);
 
                 if (hasAbility) {
                     int result = QMessageBox::question(this,
-                                      selectedPiece->name,
+                                      name,
                                       "Do you want to use this piece's special ability?",
                                       QMessageBox::Yes | QMessageBox::No,
                                       QMessageBox::No);
 
-                    if (result == QMessageBox::Yes) {
-                        bool isBomb = dynamic_cast<Bomb*>(selectedPiece) != nullptr;
-                        bool isKnight = dynamic_cast<Knight*>(selectedPiece) != nullptr;
-                        bool isQueen = dynamic_cast<Queen*>(selectedPiece) != nullptr;
-                        bool isKing = dynamic_cast<King*>(selectedPiece) != nullptr;
-                        bool isBishop = dynamic_cast<Bishop*>(selectedPiece) != nullptr;
-
-                        bool abilitySucceeded = selectedPiece->specialAbility(scene);
-
-                        if (abilitySucceeded) {
-                            QString abilityMessage;
-                            if (isBomb) {
-                                abilityMessage = "\nBomb exploded!";
-                            } else if (isKnight) {
-                                abilityMessage = "\nKnight used Charge!";
-                            } else if (isQueen) {
-                                abilityMessage = "\nQueen used Royal Command!";
-                            } else if (isKing) {
-                                abilityMessage = "\nKing used Divine Protection!";
-                            } else if (isBishop) {
-                                abilityMessage = "\nBishop used Holy Light!";
-                            }
-
-                            showCaptureMessage(abilityMessage);
-
-                            // checking the death
-                            bool playerOneHasPieces = false;
-                            bool playerTwoHasPieces = false;
-                            bool playerOneKingAlive = false;
-                            bool playerTwoKingAlive = false;
-
-                            for (auto item : scene->items()) {
-                                Piece* piece = dynamic_cast<Piece*>(item);
-                                if (piece) {
-                                    if (piece->isPlayerOne) {
-                                        playerOneHasPieces = true;
-                                        if (dynamic_cast<King*>(piece)) {
-                                            playerOneKingAlive = true;
-                                        }
-                                    } else {
-                                        playerTwoHasPieces = true;
-                                        if (dynamic_cast<King*>(piece)) {
-                                            playerTwoKingAlive = true;
-                                        }
-                                    }
-                                }
-                            }
-
-                            // checking for the winner
-                            if (!playerOneKingAlive || !playerOneHasPieces) {
-                                QMessageBox::information(this, "WIN!!!", "Player2 win！");
-                                qApp->quit();
-                            }
-                            if (!playerTwoKingAlive || !playerTwoHasPieces) {
-                                QMessageBox::information(this, "WIN!!!", "Player1 win！");
-                                qApp->quit();
-                            }
-
-                            switchPlayer();
+                    // the handle tells whether the piece is still there after the dialogs
+                    if (result == QMessageBox::Yes && piecePool.get(selectedPiece)) {
+                        RuleError error;
+                        Action ability = Action::ability(sq);
+                        if (!submitAction(ability, error)) {
+                            QMessageBox::warning(this, QStringLiteral("CANNOT USE!"), ruleErrorText(error), QMessageBox::Ok);
                         }
                     }
                 } else {
-                    QMessageBox::information(this, selectedPiece->name, "This piece has no special ability.");
+                    QMessageBox::information(this, name, "This piece has no special ability.");
                 }
 
-                selectedPiece = nullptr;
+                selectPiece(PieceHandle());
             }
         }
     }
@@ -398,148 +789,166 @@ void MainWindow::onGraphicsViewClicked(QPointF point)
         QMessageBox::information(this, "Game Over", "Have Fun!");
                 return;
     }
+    if (currentPlayer == computerPlayer) {
+        engineHost.stop(); // move now, with the best action found so far
+        return;
+    }
+    if (netMatch && (!netStarted || currentPlayer != netSeat)) {
+        statusBar()->showMessage(netStarted ? "The other player's turn" : "Waiting for an opponent", 3000);
+        return;
+    }
     const int cellSize = 50;
     int x = static_cast<int>(point.x()) / cellSize;
     int y = static_cast<int>(point.y()) / cellSize;
 
-    int prev_x;
-    int prev_y;
-
-    if (x < 0 || x >= 14 || y < 0 || y >= 14) {
-        if (selectedPiece != nullptr)
-            selectedPiece = nullptr;
+    if (!BoardState::inside(x, y)) {
+        selectPiece(PieceHandle());
         return;
     }
 
-    if (selectedPiece) {
-        bool occupied = false;
-        Piece* targetPiece = nullptr;
-
-        prev_x = selectedPiece->x;
-        prev_y = selectedPiece->y;
-
-        for (auto item : scene->items()) {
-            Piece *piece = dynamic_cast<Piece*>(item);
-            if (piece && piece->x == x && piece->y == y) {
-                occupied = true;
-                targetPiece = piece;
-                break;
-            }
+    const Piece *piece = FindPieceAtXY(x, y);
+    bool ownPiece = piece && piece->isPlayerOne == (currentPlayer == 1);
+    if (const Piece *selected = piecePool.get(selectedPiece)) {
+        // another piece of the same side takes over the selection, the same one drops it
+        if (ownPiece) {
+            selectPiece(piece == selected ? PieceHandle() : pieceGrid[BoardState::index(x, y)]);
+            return;
         }
+        RuleError error;
+        Action move = Action::move(BoardState::index(selected->x, selected->y), BoardState::index(x, y));
+        selectPiece(PieceHandle());
+        if (!submitAction(move, error)) {
+            // the targets were on the board already, no dialog to click away
+            statusBar()->showMessage(ruleErrorText(error), 3000);
+        }
+        return;
+    }
 
-        if (!occupied) {
-            // if the target is empty
+    // seeking for piece //
+    if (ownPiece) {
+        selectPiece(pieceGrid[BoardState::index(x, y)]);
+    }
+}
 
-            // can go over the piece
-            Piece * midPiece = nullptr;
-            int moveX = std::abs(prev_x - x);
-            int moveY = std::abs(prev_y - y);
-            if (moveX == moveY && moveX == 2 ){
-                midPiece = FindPieceAtXY((prev_x+x)/2, (prev_y + y)/2, scene);
-            } else if (moveX == 0 && moveY == 2) {
-                midPiece = FindPieceAtXY((prev_x+x)/2, (prev_y + y)/2, scene);
-            } else if (moveY == 0 && moveX == 2){
-                midPiece = FindPieceAtXY((prev_x+x)/2, (prev_y + y)/2, scene);
-            }
-            if (midPiece){
-                QMessageBox::information(this, "Invalid Movement", "Can go over pieces");
-                return;
-            }
+void MainWindow::selectPiece(PieceHandle handle)
+{
+    selectedPiece = handle;
+    if (const Piece *selected = piecePool.get(handle)) {
+        showTargets(BoardState::index(selected->x, selected->y));
+    } else {
+        hideTargets();
+    }
+}
 
-            selectedPiece->moveTo(x, y, scene);
-
-            if ( prev_x != selectedPiece->x || prev_y != selectedPiece->y){
-                switchPlayer();
-            }else {
-                QString errorMsg;
-                switch(selectedPiece->getErrorCase()) {
-                    case 1:
-                        errorMsg = "Can only move 1 horizontally or perpendicularly in the mountains!";
-                        break;
-                    case 2:
-                        errorMsg = "Can only move 2 in the forest!";
-                        break;
-                    case 3:
-                        errorMsg = "Bomb cannot cross the river!";
-                        break;
-                    case 4:
-                        errorMsg = "Queen cannot cross the river!";
-                        break;
-                    case 5:
-                        errorMsg = "King cannot cross the river!";
-                        break;
-                    case 6:
-                        errorMsg = "Bishop cannot cross the river!";
-                        break;
-                    default:
-                        errorMsg = "Invalid move!";
+void MainWindow::updateTurnTargets()
+{
+    if (targetsReady && targetsKey == state.hash) {
+        return;
+    }
+    const int owner = BoardState::side(state.playerOneToMove());
+    for (SquareTargets &targets : turnTargets) {
+        targets = SquareTargets();
+    }
+    Bitboard pieces = state.occupancy[owner];
+    while (pieces.any()) {
+        int sq = pieces.popFirst();
+        SquareTargets &targets = turnTargets[sq];
+        if (state.result != GameResult::Ongoing) {
+            continue;
+        }
+        Bitboard legal = moveTargets(state, sq);
+        targets.captures = legal & state.occupancy[1 - owner];
+        targets.quiet = legal & ~state.occupancy[1 - owner];
+
+        // the rest of the piece's own pattern, kept when the terrain is what refuses it
+        int x = sq % BoardCols;
+        int y = sq / BoardCols;
+        const MovementRule &rule = movementRules[static_cast<int>(state.squares[sq].type)];
+        for (int dy = -2; dy <= 2; ++dy) {
+            for (int dx = -2; dx <= 2; ++dx) {
+                if (!rule.reaches(dx, dy) || !BoardState::inside(x + dx, y + dy)
+                    || legal.test(BoardState::index(x + dx, y + dy))) {
+                    continue;
                 }
-                QMessageBox::information(this, "Invalid Movement", errorMsg);
-            }
-            selectedPiece = nullptr;
-
-        } else {
-
-            // if not empty, check for eat
-            if (targetPiece->isPlayerOne == selectedPiece->isPlayerOne) {
-                // self-piece -> invalid
-                QMessageBox::information(this, "Invalid Movement", "Cannot eat self-piece!");
-                selectedPiece = nullptr;
-            } else {
-                // Cannot eat in the desert
-                if (getTerrain(selectedPiece->y, selectedPiece->x) == TerrainType::Desert) {
-                    QMessageBox::information(this, "Invalid Movement", "Cannot eat in the desert");
-                    selectedPiece = nullptr;
-                    return;
+                switch (checkMove(state, x, y, x + dx, y + dy)) {
+                case RuleError::MountainLimit:
+                case RuleError::ForestLimit:
+                case RuleError::BombRiver:
+                case RuleError::QueenRiver:
+                case RuleError::KingRiver:
+                case RuleError::BishopRiver:
+                case RuleError::DesertCapture:
+                    targets.blocked.set(BoardState::index(x + dx, y + dy));
+                    break;
+                default:
+                    break;
                 }
-                // eating----------------------------
-                // moving
-                selectedPiece->moveTo(x, y, scene);
-                if (selectedPiece->x == prev_x && selectedPiece->y == prev_y){
-                    QMessageBox::information(this, "Invalid Movement", "Movement Failed!");
-                    selectedPiece = nullptr;
-                }else {
-                    // eating message
-
-                    QString eatMessage = selectedPiece->name + " ate " + targetPiece->name + ". ";
-                    if(targetPiece -> name == "King"){
-                        checkForVictory(scene,eatMessage,gameOver);
-                    }
-
-                    if (selectedPiece->name == "Bomb" && targetPiece->name != "Bomb" ){
-                        eatMessage = "Bomb exploded! AND " + targetPiece->name +" died!";
-                        scene->removeItem(selectedPiece);
-                        scene->removeItem(targetPiece);
-                    } else if(targetPiece->name == "Bomb" && selectedPiece->name != "Bomb"){
-                        eatMessage = selectedPiece->name + " encountered BOMB and exploded!";
-                        scene->removeItem(selectedPiece);
-                        scene->removeItem(targetPiece);
-                    }else if (targetPiece->name == "Bomb" && selectedPiece->name == "Bomb"){
-                        eatMessage = "Two Bombs exploded!";
-                        scene->removeItem(selectedPiece);
-                        scene->removeItem(targetPiece);
-                    }
-                    showCaptureMessage(eatMessage);
+            }
+        }
 
-                    delete targetPiece;
-                    selectedPiece = nullptr;
-                    switchPlayer();
+        // the ability is played on a copy, every square it changes is its target
+        if (abilityIsLegal(state, sq)) {
+            BoardState after = state;
+            applyAction(after, Action::ability(sq));
+            for (int target = 0; target < BoardSquares; ++target) {
+                const PieceState &was = state.squares[target];
+                const PieceState &now = after.squares[target];
+                if (was.type != now.type || was.isPlayerOne != now.isPlayerOne
+                    || was.abilityUsesLeft != now.abilityUsesLeft) {
+                    targets.ability.set(target);
                 }
             }
         }
-        return;
     }
+    targetsKey = state.hash;
+    targetsReady = true;
+}
 
-    // seeking for piece //
-    for (auto item : scene->items()) {
-        Piece *piece = dynamic_cast<Piece*>(item);
-        if(piece) {
-            if (piece && piece->x == x && piece->y == y && piece->isPlayerOne == (currentPlayer == 1)) {
-                selectedPiece = piece;
-                break;
-            }
+void MainWindow::showTargets(int sq)
+{
+    updateTurnTargets();
+    const int cellSize = BoardScene::CellSize;
+    if (targetMarkers.empty()) {
+        // made once, above the pieces; clicks go through the event filter, not the items
+        for (int square = 0; square < BoardSquares; ++square) {
+            QGraphicsRectItem *marker = scene->addRect(square % BoardCols * cellSize + 1, square / BoardCols * cellSize + 1,
+                                                       cellSize - 2, cellSize - 2);
+            marker->setZValue(1);
+            marker->setAcceptedMouseButtons(Qt::NoButton);
+            marker->hide();
+            targetMarkers.push_back(marker);
         }
     }
-}
 
+    const SquareTargets &targets = turnTargets[sq];
+    for (int square = 0; square < BoardSquares; ++square) {
+        QGraphicsRectItem *marker = targetMarkers[square];
+        QPen pen(Qt::NoPen);
+        QBrush brush(Qt::NoBrush);
+        if (targets.ability.test(square)) {
+            pen = QPen(QColor(255, 140, 0), 3);
+        } else if (square == sq) {
+            pen = QPen(QColor(255, 215, 0), 3);
+        }
+        if (targets.captures.test(square)) {
+            brush = QBrush(QColor(220, 0, 0, 110));
+        } else if (targets.quiet.test(square)) {
+            brush = QBrush(QColor(0, 200, 0, 90));
+        } else if (targets.blocked.test(square)) {
+            brush = QBrush(QColor(60, 60, 60, 140), Qt::BDiagPattern);
+        }
+        bool shown = pen.style() != Qt::NoPen || brush.style() != Qt::NoBrush;
+        if (shown) {
+            marker->setPen(pen);
+            marker->setBrush(brush);
+        }
+        marker->setVisible(shown);
+    }
+}
 
+void MainWindow::hideTargets()
+{
+    for (QGraphicsRectItem *marker : targetMarkers) {
+        marker->hide();
+    }
+}
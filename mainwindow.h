@@ -2,11 +2,20 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QGraphicsScene>
+#include "boardscene.h"
 #include "piece.h"
 #include "terrain.h"
+#include "rules.h"
+#include "enginehost.h"
+#include "netclient.h"
+#include "record.h"
+#include "book.h"
+#include "tablebase.h"
 #include <vector>
 
+class QActionGroup;
+class QGraphicsRectItem;
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
@@ -16,11 +25,12 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // scenarioPath: a scenario or a game record to start from instead of the standard setup
+    MainWindow(QWidget *parent = nullptr, const QString &scenarioPath = QString());
     TerrainType getTerrain(int x, int y);
     void showCaptureMessage(QString & message); // eating message box
     ~MainWindow();
-    static Piece * FindPieceAtXY(int x, int y, QGraphicsScene *scene); // find pieces at x & y
+    const Piece * FindPieceAtXY(int x, int y) const; // find pieces at x & y
 
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
@@ -28,17 +38,81 @@ protected:
 private:
     bool gameOver;// flag
     Ui::MainWindow *ui;
-    QGraphicsScene *scene;
+    BoardScene *scene;
     int currentPlayer; // 1 or 2; standing for player1 or player 2
-    Piece *selectedPiece; // the selected piece currently
+    PieceHandle selectedPiece; // the selected piece currently, stale once the piece is taken off
+    // where each piece of the side to move can go, worked out once per position
+    struct SquareTargets {
+        Bitboard quiet;    // legal moves to empty squares
+        Bitboard captures; // legal moves onto enemies
+        Bitboard blocked;  // in the piece's pattern but refused by the terrain
+        Bitboard ability;  // squares its ability changes, empty when it cannot use it
+    };
+    SquareTargets turnTargets[BoardSquares];
+    std::uint64_t targetsKey = 0; // hash of the position turnTargets is for, terrain not included
+    bool targetsReady = false;    // cleared whenever the state is replaced
+    std::vector<QGraphicsRectItem *> targetMarkers; // one per square, hidden when unused
 
     Terrain terrain; // class
-    std::vector<Piece*> player1Pieces;
-    std::vector<Piece*> player2Pieces;
+    BoardState state; // the rules core; the pieces in the scene only mirror it
+    int computerPlayer = 0; // player moved by the engine, 0 for two humans
+    OpeningBook book; // for both engines while the Computer menu has it on
+    Tablebases tablebases; // endgame tables next to the program, when there are any
+    EngineHost engineHost; // both engines, on a thread of their own; after what they read, so it stops first
+    quint64 engineJob = 0;   // the search whose action is played, 0 when none runs
+    quint64 analysisJob = 0; // the analysis of a human turn, 0 when none runs
+    bool analysing = false;  // Computer menu: analyse the positions of the human players
+    NetClient net;                 // to a gameserver, for a match against another window
+    QString serverAddress = "127.0.0.1:7070";
+    Message netRequest;            // Create or Join, sent once connected
+    std::uint32_t netMatch = 0;    // the match of this window, 0 for a local game
+    int netSeat = 0;               // the player this window moves in it
+    bool netStarted = false;       // both seats taken
+    QActionGroup *playerChoices = nullptr; // off during a network match
+    std::vector<std::uint64_t> playedKeys; // positions before the current one, for repetitions
+    struct PlayedAction {
+        Action action;
+        UndoRecord undo;
+    };
+    std::vector<PlayedAction> history; // every action of the game, for undo
+    std::vector<Action> redoActions;   // taken back, the next one to redo last
+    BoardState startState;             // where history starts
+    RecordWriter recordWriter;         // streams every action once a record file is picked
+    PiecePool piecePool; // every piece item, reused; goes before the scene, a child QObject
+    PieceHandle pieceGrid[BoardSquares]; // piece item of every square, invalid when empty
+    std::vector<PieceHandle> player1Pieces; // reserved for a full board, never reallocated
+    std::vector<PieceHandle> player2Pieces;
 
     void setupGameBoard();
-    void addLegend();
     void addPieces();
+    bool loadScenario(const QString &path); // a scenario, or a game record played to its end; false after a warning
+    void syncPieces(); // rebuild the piece items from state
+    void updatePieces(const BoardState &before); // move, add and remove the items that changed
+    void addPieceItem(int sq);
+    void removePieceItem(PieceHandle handle);
+    bool announceResult(); // true when the game is over
+    bool playAction(const Action &action, RuleError &error); // apply, redraw and pass the turn
+    void addComputerMenu();
+    void addGameMenu();
+    void undoAction(); // back to the last position of a human player
+    void redoAction();
+    void recordGame();
+    void startEngine(); // the computer's search on its turn, else the analysis when it is on
+    void stopEngine();  // the answer of the running search is dropped
+    void onEngineProgress(quint64 job, const QString &text);
+    void onEngineFinished(quint64 job, bool found, Action best);
+    void selectPiece(PieceHandle handle); // an invalid handle clears the selection
+    void updateTurnTargets();
+    void showTargets(int sq);
+    void hideTargets();
+    void addNetworkMenu();
+    void requestMatch(const Message &request); // connects, then sends the request
+    void leaveMatch();
+    void endNetworkMatch();
+    void onNetMessage(const Message &message);
+    void onNetFailed(const QString &error);
+    void newGame(); // the standard setup on the standard terrain, as the server plays it
+    bool submitAction(const Action &action, RuleError &error); // a human's action, here or through the server
     void switchPlayer();
     void handleMove(int destX, int destY);
     void onGraphicsViewClicked(QPointF point);
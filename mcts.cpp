@@ -0,0 +1,327 @@
+// mcts.cpp
+#include "mcts.h"
+#include "book.h"
+#include "eval.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+const int MaxTreeDepth = 256;
+const int ExpandVisits = 2;       // a leaf gets children on its second visit
+const int PlayoutMargin = 300;    // eval lead that counts as a win when a playout is cut
+const int ProgressMs = 100;
+
+std::uint64_t nextRandom(std::uint64_t &state)
+{
+    // splitmix64
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// material an action takes, Bombs cost the attacker too
+int actionGain(const BoardState &state, const Action &action)
+{
+    if (action.isAbility) {
+        return abilityGain(state, action);
+    }
+    PieceType attacker = state.squares[action.from].type;
+    PieceType victim = state.squares[action.to].type;
+    if (victim == PieceType::None) {
+        return 0;
+    }
+    if (attacker == PieceType::Bomb || victim == PieceType::Bomb) {
+        return pieceValue(victim) - pieceValue(attacker);
+    }
+    return pieceValue(victim);
+}
+
+// how a finished or cut playout ends for the players
+GameResult judge(const BoardState &state)
+{
+    if (state.result != GameResult::Ongoing) {
+        return state.result;
+    }
+    int score = evaluate(state);
+    if (score > -PlayoutMargin && score < PlayoutMargin) {
+        return GameResult::Draw;
+    }
+    return (score > 0) == state.playerOneToMove() ? GameResult::PlayerOneWins : GameResult::PlayerTwoWins;
+}
+
+} // namespace
+
+Mcts::Mcts(int threads, std::size_t maxNodes)
+    : nodes(new MctsNode[maxNodes]), capacity(maxNodes), threadCount(threads < 1 ? 1 : threads)
+{
+}
+
+MctsResult Mcts::think(const BoardState &root, const MctsLimits &searchLimits)
+{
+    MctsResult bookResult;
+    if (book && book->pick(root, root.hash ^ bookSeed, bookResult.best)) {
+        bookResult.found = true;
+        bookResult.fromBook = true;
+        return bookResult;
+    }
+
+    limits = searchLimits;
+    startTime = std::chrono::steady_clock::now();
+    stopped = cancel && cancel();
+    totalRollouts = 0;
+
+    // the pool is reused, only the nodes of the last search need a reset
+    std::size_t last = std::min<std::size_t>(used, capacity);
+    for (std::size_t i = 0; i < last; ++i) {
+        MctsNode &node = nodes[i];
+        node.action = Action();
+        node.prior = 0;
+        node.visits = 0;
+        node.halfPoints = 0;
+        node.firstChild = -1;
+        node.childCount = 0;
+        node.expansion = 0;
+    }
+    used = 1;
+
+    MctsResult result;
+    if (!expand(0, root) || nodes[0].childCount == 0) {
+        return result;
+    }
+
+    std::vector<unsigned long long> rollouts(threadCount, 0);
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threadCount; ++i) {
+        helpers.emplace_back([this, &root, &rollouts, i]() { runThread(root, 0x51ED5EEDULL * (i + 1), false, rollouts[i]); });
+    }
+    runThread(root, 0x51ED5EEDULL, true, rollouts[0]);
+    stopped = true;
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    summarize(result);
+    result.threadRollouts = rollouts;
+    for (unsigned long long count : rollouts) {
+        result.rollouts += count;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    result.rolloutsPerSecond = result.seconds > 0 ? result.rollouts / result.seconds : 0;
+    return result;
+}
+
+void Mcts::summarize(MctsResult &result) const
+{
+    // the most visited action is the most trusted one
+    const MctsNode &top = nodes[0];
+    int bestChild = top.firstChild;
+    for (int i = 0; i < top.childCount; ++i) {
+        int child = top.firstChild + i;
+        if (nodes[child].visits > nodes[bestChild].visits) {
+            bestChild = child;
+        }
+    }
+    const MctsNode &best = nodes[bestChild];
+    int visits = best.visits;
+    result.found = true;
+    result.best = best.action;
+    result.bestVisits = visits;
+    result.winRate = visits ? best.halfPoints / (2.0 * visits) : 0;
+    result.treeNodes = used < capacity ? used.load() : capacity;
+}
+
+void Mcts::runThread(const BoardState &root, std::uint64_t seed, bool reports, unsigned long long &rollouts)
+{
+    std::uint64_t random = seed;
+    auto lastReport = startTime;
+    int path[MaxTreeDepth];
+    bool moverIsPlayerOne[MaxTreeDepth];
+
+    while (!outOfBudget()) {
+        BoardState state = root;
+        int length = 0;
+        int node = 0;
+        nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+
+        // descend; the visit is counted on the way down, so other threads see it as a loss
+        // and spread out until the playout result arrives
+        while (state.result == GameResult::Ongoing && length < MaxTreeDepth) {
+            MctsNode &current = nodes[node];
+            if (current.expansion.load(std::memory_order_acquire) != 2) {
+                if (current.visits.load(std::memory_order_relaxed) < ExpandVisits || !expand(node, state)) {
+                    break;
+                }
+            }
+            if (current.childCount == 0) {
+                break;
+            }
+            int child = select(node);
+            path[length] = child;
+            moverIsPlayerOne[length] = state.playerOneToMove();
+            ++length;
+            nodes[child].visits.fetch_add(1, std::memory_order_relaxed);
+            applyAction(state, nodes[child].action);
+            node = child;
+        }
+
+        GameResult outcome;
+        if (state.result != GameResult::Ongoing) {
+            outcome = state.result;
+        } else if (nodes[node].expansion.load(std::memory_order_acquire) == 2 && nodes[node].childCount == 0) {
+            outcome = GameResult::Draw; // no legal action
+        } else {
+            outcome = playout(state, random);
+        }
+        for (int i = 0; i < length; ++i) {
+            int points = outcome == GameResult::Draw ? 1
+                : (outcome == GameResult::PlayerOneWins) == moverIsPlayerOne[i] ? 2 : 0;
+            nodes[path[i]].halfPoints.fetch_add(points, std::memory_order_relaxed);
+        }
+        ++rollouts;
+
+        if (reports && progress
+            && std::chrono::steady_clock::now() - lastReport >= std::chrono::milliseconds(ProgressMs)) {
+            lastReport = std::chrono::steady_clock::now();
+            MctsResult report;
+            summarize(report);
+            report.rollouts = totalRollouts.load(std::memory_order_relaxed);
+            report.seconds = std::chrono::duration<double>(lastReport - startTime).count();
+            report.rolloutsPerSecond = report.seconds > 0 ? report.rollouts / report.seconds : 0;
+            progress(report);
+        }
+    }
+}
+
+int Mcts::select(int parent) const
+{
+    const MctsNode &node = nodes[parent];
+    int first = node.firstChild;
+    double parentVisits = node.visits.load(std::memory_order_relaxed);
+    double logVisits = std::log(parentVisits + 1);
+    double sqrtVisits = std::sqrt(parentVisits);
+
+    int best = first;
+    double bestScore = -1;
+    for (int i = 0; i < node.childCount; ++i) {
+        const MctsNode &child = nodes[first + i];
+        int visits = child.visits.load(std::memory_order_relaxed);
+        double score;
+        if (limits.selection == MctsSelection::Uct) {
+            if (visits == 0) {
+                return first + i; // every action once before any is repeated
+            }
+            double mean = child.halfPoints.load(std::memory_order_relaxed) / (2.0 * visits);
+            score = mean + limits.exploration * std::sqrt(logVisits / visits);
+        } else {
+            double mean = visits ? child.halfPoints.load(std::memory_order_relaxed) / (2.0 * visits) : 0.5;
+            score = mean + limits.exploration * child.prior * sqrtVisits / (1 + visits);
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            best = first + i;
+        }
+    }
+    return best;
+}
+
+// adds the children of a leaf; false when another thread is at it or the pool is full
+bool Mcts::expand(int index, const BoardState &state)
+{
+    MctsNode &node = nodes[index];
+    if (used.load(std::memory_order_relaxed) >= capacity) {
+        return false;
+    }
+    std::uint8_t leaf = 0;
+    if (!node.expansion.compare_exchange_strong(leaf, 1, std::memory_order_acq_rel)) {
+        return node.expansion.load(std::memory_order_acquire) == 2;
+    }
+
+    ActionList list;
+    generateActions(state, list);
+    std::size_t first = used.fetch_add(list.size, std::memory_order_relaxed);
+    if (first + list.size > capacity) {
+        node.expansion.store(0, std::memory_order_release); // stays a leaf, playouts only
+        return false;
+    }
+
+    // priors: material taken, a little weight for the quiet actions, less for wasted abilities
+    double weights[ActionList::Capacity];
+    double total = 0;
+    for (int i = 0; i < list.size; ++i) {
+        int gain = actionGain(state, list[i]);
+        double weight = gain > 0 ? 1.0 + gain / 100.0 : gain < 0 || list[i].isAbility ? 0.3 : 1.0;
+        weights[i] = weight;
+        total += weight;
+    }
+    for (int i = 0; i < list.size; ++i) {
+        MctsNode &child = nodes[first + i];
+        child.action = list[i];
+        child.prior = static_cast<float>(weights[i] / total);
+    }
+    node.firstChild.store(static_cast<int>(first), std::memory_order_relaxed);
+    node.childCount.store(list.size, std::memory_order_relaxed);
+    node.expansion.store(2, std::memory_order_release);
+    return true;
+}
+
+// plays random actions to the end of the game or the ply cap; guided playouts take
+// a capture or a paying ability half of the time when there is one
+GameResult Mcts::playout(BoardState state, std::uint64_t &random) const
+{
+    ActionList list;
+    int noisy[ActionList::Capacity];
+    for (int ply = 0; ply < limits.playoutPlies && state.result == GameResult::Ongoing; ++ply) {
+        TableValue value;
+        if (tablebases && tablebases->probe(state, value)) {
+            if (value.kind == TableValue::Draw) {
+                return GameResult::Draw;
+            }
+            bool playerOneWins = (value.kind == TableValue::Win) == state.playerOneToMove();
+            return playerOneWins ? GameResult::PlayerOneWins : GameResult::PlayerTwoWins;
+        }
+        generateActions(state, list);
+        if (list.size == 0) {
+            return GameResult::Draw;
+        }
+        std::uint64_t draw = nextRandom(random);
+        int pick = static_cast<int>((draw >> 1) % list.size);
+        if (limits.guidedPlayouts && (draw & 1)) {
+            int noisyCount = 0;
+            for (int i = 0; i < list.size; ++i) {
+                if (actionGain(state, list[i]) > 0) {
+                    noisy[noisyCount++] = i;
+                }
+            }
+            if (noisyCount) {
+                pick = noisy[(draw >> 1) % noisyCount];
+            }
+        }
+        applyAction(state, list[pick]);
+    }
+    return judge(state);
+}
+
+bool Mcts::outOfBudget()
+{
+    if (stopped.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (cancel && cancel()) {
+        stopped = true;
+        return true;
+    }
+    unsigned long long total = totalRollouts.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (limits.maxRollouts && total > limits.maxRollouts) {
+        stopped = true;
+    } else if (limits.timeMs) {
+        auto elapsed = std::chrono::steady_clock::now() - startTime;
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= limits.timeMs) {
+            stopped = true;
+        }
+    }
+    return stopped.load(std::memory_order_relaxed);
+}
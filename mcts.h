@@ -0,0 +1,98 @@
+// mcts.h
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "movegen.h"
+
+enum class MctsSelection {
+    Uct,   // mean result plus the classic log-visit exploration term
+    Puct   // exploration weighted by a prior from captures and ability gains
+};
+
+struct MctsLimits {
+    int timeMs = 1000;                    // 0: no time limit
+    unsigned long long maxRollouts = 0;   // 0: no rollout limit, counted over all threads
+    MctsSelection selection = MctsSelection::Puct;
+    double exploration = 1.4;
+    bool guidedPlayouts = true;           // prefer captures in the playouts, else uniform random
+    int playoutPlies = 160;               // longer playouts are judged by evaluate()
+};
+
+struct MctsResult {
+    Action best;
+    bool found = false;       // false when the side to move has no legal action
+    double winRate = 0;       // of the best action, draws count half
+    int bestVisits = 0;
+    unsigned long long rollouts = 0;
+    std::vector<unsigned long long> threadRollouts; // per thread, the calling thread first
+    std::size_t treeNodes = 0;
+    double seconds = 0;
+    double rolloutsPerSecond = 0;
+    bool fromBook = false;    // played from the opening book without a search
+};
+
+class OpeningBook;
+class Tablebases;
+
+// shared tree node; results are stored for the player who played action
+struct MctsNode {
+    Action action;
+    float prior = 0;
+    std::atomic<int> visits{0};         // virtual losses included until the result is backed up
+    std::atomic<int> halfPoints{0};     // 2 for a win, 1 for a draw
+    std::atomic<int> firstChild{-1};
+    std::atomic<int> childCount{0};
+    std::atomic<std::uint8_t> expansion{0}; // 0 leaf, 1 being expanded, 2 children ready
+};
+
+// Monte Carlo tree search over the headless rules; all threads descend the same
+// tree from a fixed node pool, a visit counts as a loss until its playout is backed up
+class Mcts {
+public:
+    explicit Mcts(int threads = 1, std::size_t maxNodes = 1 << 21);
+
+    void setThreads(int count) { threadCount = count < 1 ? 1 : count; }
+    int threads() const { return threadCount; }
+
+    MctsResult think(const BoardState &root, const MctsLimits &limits);
+    void stop() { stopped = true; } // safe to call from another thread
+    // asked before every rollout, true stops the search as stop() does; unlike
+    // stop() it also holds for a search that is only about to start
+    void setCancel(std::function<bool()> check) { cancel = std::move(check); }
+    // called on the thread of think() about every 100 ms with the best action so far
+    void setProgress(std::function<void(const MctsResult &)> report) { progress = std::move(report); }
+    // book positions are answered from book, seed varies the choice between its actions
+    void setBook(const OpeningBook *openingBook, std::uint64_t seed = 0) { book = openingBook; bookSeed = seed; }
+    // playouts stop at positions the endgame tables hold, with their result
+    void setTablebases(const Tablebases *tables) { tablebases = tables; }
+
+private:
+    void runThread(const BoardState &root, std::uint64_t seed, bool reports, unsigned long long &rollouts);
+    void summarize(MctsResult &result) const; // best action, its win rate and the tree size
+    int select(int parent) const;
+    bool expand(int node, const BoardState &state);
+    GameResult playout(BoardState state, std::uint64_t &random) const;
+    bool outOfBudget();
+
+    std::unique_ptr<MctsNode[]> nodes;
+    std::size_t capacity;
+    std::atomic<std::size_t> used{0};
+    int threadCount;
+    const OpeningBook *book = nullptr;
+    std::uint64_t bookSeed = 0;
+    const Tablebases *tablebases = nullptr;
+    std::function<bool()> cancel;
+    std::function<void(const MctsResult &)> progress;
+    MctsLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<bool> stopped{false};
+    std::atomic<unsigned long long> totalRollouts{0};
+};
+
+#endif // MCTS_H
@@ -0,0 +1,164 @@
+// movegen.cpp
+#include "movegen.h"
+#include "movement.h"
+
+namespace {
+
+// per-square targets of every movement rule, built once from the movement table
+struct MoveTables {
+    Bitboard reach[MovementRuleCount][BoardSquares];
+    // the 8 straight and diagonal two-steps: square passed over and target, -1 off the board
+    int passed[BoardSquares][8];
+    int twoStep[BoardSquares][8];
+
+    MoveTables() {
+        const int directions[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+        for (int y = 0; y < BoardRows; ++y) {
+            for (int x = 0; x < BoardCols; ++x) {
+                int sq = BoardState::index(x, y);
+                for (int rule = 0; rule < MovementRuleCount; ++rule) {
+                    for (int dy = -2; dy <= 2; ++dy) {
+                        for (int dx = -2; dx <= 2; ++dx) {
+                            if (BoardState::inside(x + dx, y + dy) && movementRules[rule].reaches(dx, dy)) {
+                                reach[rule][sq].set(BoardState::index(x + dx, y + dy));
+                            }
+                        }
+                    }
+                }
+                for (int d = 0; d < 8; ++d) {
+                    int farX = x + 2 * directions[d][0];
+                    int farY = y + 2 * directions[d][1];
+                    bool inside = BoardState::inside(farX, farY);
+                    passed[sq][d] = inside ? BoardState::index(x + directions[d][0], y + directions[d][1]) : -1;
+                    twoStep[sq][d] = inside ? BoardState::index(farX, farY) : -1;
+                }
+            }
+        }
+    }
+};
+
+const MoveTables &tables()
+{
+    static const MoveTables moveTables;
+    return moveTables;
+}
+
+// drops the two-steps going over a square of the wall
+Bitboard dropBlocked(const MoveTables &t, int sq, Bitboard targets, Bitboard wall)
+{
+    for (int d = 0; d < 8; ++d) {
+        int mid = t.passed[sq][d];
+        if (mid >= 0 && wall.test(mid)) {
+            targets.clear(t.twoStep[sq][d]);
+        }
+    }
+    return targets;
+}
+
+} // namespace
+
+Bitboard moveTargets(const BoardState &state, int sq)
+{
+    const MoveTables &t = tables();
+    const PieceState &piece = state.squares[sq];
+    if (piece.type == PieceType::None) {
+        return Bitboard();
+    }
+    int owner = BoardState::side(piece.isPlayerOne);
+
+    // same rule as checkMove: the terrain of the start square first, then the piece
+    int rule = movementIndex(piece.type, state.terrain[sq]);
+    const MovementRule &movement = movementRules[rule];
+    Bitboard targets = t.reach[rule][sq];
+    Bitboard wall = state.occupied();
+    if (!movement.crossesRiver) {
+        Bitboard river = state.terrainBits(TerrainType::River);
+        targets &= ~river;
+        wall |= river;
+    }
+    if (movement.straightRange == 2 || movement.diagonalRange == 2) {
+        targets = dropBlocked(t, sq, targets, wall);
+    }
+
+    targets &= ~state.occupancy[owner];
+    if (state.terrainBits(TerrainType::Desert).test(sq)) {
+        targets &= ~state.occupancy[1 - owner]; // no capture from the desert
+    }
+    return targets;
+}
+
+bool abilityIsLegal(const BoardState &state, int sq)
+{
+    const PieceState &piece = state.squares[sq];
+    int owner = BoardState::side(piece.isPlayerOne);
+    int x = sq % BoardCols;
+    int y = sq / BoardCols;
+    int forward = piece.isPlayerOne ? 1 : -1;
+
+    switch (piece.type) {
+    case PieceType::Knight:
+        // the charge must get at least one square: not at the edge, no teammate in front
+    case PieceType::Bishop:
+        // the spawn square must be on the board and free of teammates
+        return piece.abilityUsesLeft > 0 && BoardState::inside(x, y + forward)
+            && !state.occupancy[owner].test(BoardState::index(x, y + forward));
+    case PieceType::Bomb:
+        return true;
+    case PieceType::Queen: {
+        Bitboard queen = Bitboard::square(sq);
+        Bitboard columns = queen.east().east() | queen.west().west();
+        Bitboard corners = columns.north().north() | columns.south().south();
+        return (corners & state.occupancy[1 - owner]).any();
+    }
+    case PieceType::King:
+        return piece.abilityUsesLeft > 0 && state.pieces[owner][static_cast<int>(PieceType::Knight)].any();
+    default:
+        return false;
+    }
+}
+
+void generatePieceActions(const BoardState &state, int sq, ActionList &list)
+{
+    if (state.result != GameResult::Ongoing) {
+        return;
+    }
+    Bitboard targets = moveTargets(state, sq);
+    while (targets.any()) {
+        list.push(sq, targets.popFirst(), false);
+    }
+    if (abilityIsLegal(state, sq)) {
+        list.push(sq, sq, true);
+    }
+}
+
+void generateActions(const BoardState &state, ActionList &list)
+{
+    list.size = 0;
+    if (state.result != GameResult::Ongoing) {
+        return;
+    }
+    Bitboard mine = state.occupancy[BoardState::side(state.playerOneToMove())];
+    while (mine.any()) {
+        generatePieceActions(state, mine.popFirst(), list);
+    }
+}
+
+bool applyAction(BoardState &state, const Action &action, ActionResult *result)
+{
+    int x = action.from % BoardCols;
+    int y = action.from / BoardCols;
+    if (action.isAbility) {
+        return applyAbility(state, x, y, result);
+    }
+    return applyMove(state, x, y, action.to % BoardCols, action.to / BoardCols, result);
+}
+
+bool makeAction(BoardState &state, const Action &action, UndoRecord &undo, ActionResult *result)
+{
+    int x = action.from % BoardCols;
+    int y = action.from / BoardCols;
+    if (action.isAbility) {
+        return makeAbility(state, x, y, undo, result);
+    }
+    return makeMove(state, x, y, action.to % BoardCols, action.to / BoardCols, undo, result);
+}
@@ -0,0 +1,64 @@
+// movegen.h
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <cstdint>
+#include "rules.h"
+
+// one legal action of the side to move
+struct Action {
+    Square from = 0;
+    Square to = 0;            // same as from for an ability
+    bool isAbility = false;
+
+    static Action move(int from, int to) {
+        Action action;
+        action.from = static_cast<Square>(from);
+        action.to = static_cast<Square>(to);
+        return action;
+    }
+    static Action ability(int sq) {
+        Action action = move(sq, sq);
+        action.isAbility = true;
+        return action;
+    }
+
+    bool operator==(const Action &o) const { return from == o.from && to == o.to && isAbility == o.isAbility; }
+    bool operator!=(const Action &o) const { return !(*this == o); }
+};
+
+// fixed capacity, no heap: a back rank plus four spawned Pawns, with 20 targets and an
+// ability each, stay below it on every board size. Scenarios are held to MaxPieces a
+// side, the Pawns their Bishops can still spawn counted, so no position goes past it
+struct ActionList {
+    static const int MaxPieces = BoardCols + 4;
+    static const int Capacity = MaxPieces * 21 > 512 ? MaxPieces * 21 : 512;
+    Action actions[Capacity];
+    int size = 0;
+
+    void push(int from, int to, bool isAbility) {
+        actions[size++] = isAbility ? Action::ability(from) : Action::move(from, to);
+    }
+    const Action *begin() const { return actions; }
+    const Action *end() const { return actions + size; }
+    const Action &operator[](int i) const { return actions[i]; }
+};
+
+// every legal move and ability of the side to move; empty once the game is over
+void generateActions(const BoardState &state, ActionList &list);
+
+// the same for the piece on one square
+void generatePieceActions(const BoardState &state, int sq, ActionList &list);
+
+// destinations of the legal moves of the piece on sq, whoever owns it
+Bitboard moveTargets(const BoardState &state, int sq);
+
+// whether the ability of the piece on sq would be accepted by applyAbility
+bool abilityIsLegal(const BoardState &state, int sq);
+
+bool applyAction(BoardState &state, const Action &action, ActionResult *result = nullptr);
+
+// applyAction that can be taken back with takeBack
+bool makeAction(BoardState &state, const Action &action, UndoRecord &undo, ActionResult *result = nullptr);
+
+#endif // MOVEGEN_H
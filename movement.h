@@ -0,0 +1,111 @@
+// movement.h
+#ifndef MOVEMENT_H
+#define MOVEMENT_H
+
+#include <cstdint>
+#include "rules.h"
+
+// how a piece moves, or how a terrain square makes every piece on it move
+struct MovementRule {
+    std::uint8_t straightRange;  // squares along a row or a column, 0 to 2
+    std::uint8_t diagonalRange;  // squares along a diagonal, 0 to 2
+    bool leaps;                  // the (1, 2) and (2, 1) jumps of the Knight
+    bool crossesRiver;           // false: no river on the path or the target
+    RuleError patternError;      // the target is not in the pattern
+    RuleError riverError;        // the path touches the river
+
+    std::uint32_t reachMask;     // reach(), worked out once when the table is built
+
+    constexpr MovementRule(int straightRange, int diagonalRange, bool leaps, bool crossesRiver,
+                           RuleError patternError, RuleError riverError)
+        : straightRange(static_cast<std::uint8_t>(straightRange)),
+          diagonalRange(static_cast<std::uint8_t>(diagonalRange)),
+          leaps(leaps), crossesRiver(crossesRiver),
+          patternError(patternError), riverError(riverError), reachMask(0)
+    {
+        reachMask = reach();
+    }
+
+    // the reachable offsets inside the 5x5 square, bit (dy + 2) * 5 + (dx + 2);
+    // a two-step along a line cannot pass over a piece, a leap can
+    constexpr std::uint32_t reach() const {
+        std::uint32_t mask = 0;
+        for (int dy = -2; dy <= 2; ++dy) {
+            for (int dx = -2; dx <= 2; ++dx) {
+                int ax = dx < 0 ? -dx : dx;
+                int ay = dy < 0 ? -dy : dy;
+                bool straight = (ax == 0) != (ay == 0) && ax + ay <= straightRange;
+                bool diagonal = ax == ay && ax > 0 && ax <= diagonalRange;
+                bool leap = leaps && ((ax == 1 && ay == 2) || (ax == 2 && ay == 1));
+                if (straight || diagonal || leap) {
+                    mask |= std::uint32_t(1) << ((dy + 2) * 5 + dx + 2);
+                }
+            }
+        }
+        return mask;
+    }
+
+    constexpr bool reaches(int dx, int dy) const {
+        return dx >= -2 && dx <= 2 && dy >= -2 && dy <= 2 && ((reachMask >> ((dy + 2) * 5 + dx + 2)) & 1);
+    }
+};
+
+// terrain of the start square can replace the piece's own rule
+const int MountainRule = PieceTypeCount;
+const int ForestRule = PieceTypeCount + 1;
+const int MovementRuleCount = PieceTypeCount + 2;
+
+// by PieceType, then the terrain rules
+constexpr MovementRule movementRules[MovementRuleCount] = {
+    {0, 0, false, false, RuleError::InvalidMove, RuleError::InvalidMove},    // None
+    {2, 1, true,  true,  RuleError::InvalidMove, RuleError::InvalidMove},    // Knight: 5x5 square without the corners
+    {1, 0, false, true,  RuleError::InvalidMove, RuleError::InvalidMove},    // Pawn
+    {1, 0, false, false, RuleError::InvalidMove, RuleError::BombRiver},      // Bomb
+    {2, 2, false, false, RuleError::InvalidMove, RuleError::QueenRiver},     // Queen
+    {1, 1, false, false, RuleError::InvalidMove, RuleError::KingRiver},      // King
+    {0, 2, false, false, RuleError::InvalidMove, RuleError::BishopRiver},    // Bishop
+    {1, 0, false, true,  RuleError::MountainLimit, RuleError::InvalidMove},  // anything on a mountain
+    {2, 2, false, true,  RuleError::ForestLimit, RuleError::InvalidMove},    // anything in a forest
+};
+
+// movementIndex as a table: one load instead of a terrain test per call
+struct MovementIndexTable {
+    std::uint8_t index[TerrainTypeCount][PieceTypeCount] = {};
+
+    constexpr MovementIndexTable() {
+        for (int terrain = 0; terrain < TerrainTypeCount; ++terrain) {
+            for (int type = 0; type < PieceTypeCount; ++type) {
+                TerrainType origin = static_cast<TerrainType>(terrain);
+                index[terrain][type] = static_cast<std::uint8_t>(
+                    origin == TerrainType::Mountain ? MountainRule
+                    : origin == TerrainType::Forest ? ForestRule
+                    : type);
+            }
+        }
+    }
+};
+
+constexpr MovementIndexTable movementIndexTable;
+
+constexpr int movementIndex(PieceType type, TerrainType origin)
+{
+    return movementIndexTable.index[static_cast<int>(origin)][static_cast<int>(type)];
+}
+
+// the rule in force for a piece of the given type standing on the given terrain
+constexpr const MovementRule &movementRule(PieceType type, TerrainType origin)
+{
+    return movementRules[movementIndex(type, origin)];
+}
+
+// every piece but the Pawn has a special ability
+constexpr bool hasSpecialAbility(PieceType type)
+{
+    return type != PieceType::None && type != PieceType::Pawn;
+}
+
+// the Knight's 5x5 square without its centre and corners
+static_assert(movementRules[static_cast<int>(PieceType::Knight)].reachMask
+              == (0x1FFFFFFu & ~((1u << 0) | (1u << 4) | (1u << 12) | (1u << 20) | (1u << 24))), "Knight pattern");
+
+#endif // MOVEMENT_H
@@ -0,0 +1,96 @@
+// netclient.cpp
+#include "netclient.h"
+#include <QLocalSocket>
+#include <QTcpSocket>
+
+NetClient::NetClient(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void NetClient::connectTo(const QString &address)
+{
+    disconnectFrom();
+    if (address.startsWith('/')) {
+        QLocalSocket *socket = new QLocalSocket(this);
+        device = socket;
+        connect(socket, &QLocalSocket::connected, this, [this]() { ready = true; emit connected(); });
+        connect(socket, &QLocalSocket::disconnected, this, [this]() { lost("The server closed the connection."); });
+        connect(socket, &QLocalSocket::errorOccurred, this, [this, socket]() { lost(socket->errorString()); });
+        connect(socket, &QLocalSocket::readyRead, this, &NetClient::readFrames);
+        socket->connectToServer(address);
+        return;
+    }
+
+    int colon = address.lastIndexOf(':');
+    QString host = colon > 0 ? address.left(colon) : QString("127.0.0.1");
+    quint16 port = static_cast<quint16>((colon >= 0 ? address.mid(colon + 1) : address).toUInt());
+    QTcpSocket *socket = new QTcpSocket(this);
+    device = socket;
+    connect(socket, &QTcpSocket::connected, this, [this, socket]() {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        ready = true;
+        emit connected();
+    });
+    connect(socket, &QTcpSocket::disconnected, this, [this]() { lost("The server closed the connection."); });
+    connect(socket, &QTcpSocket::errorOccurred, this, [this, socket]() { lost(socket->errorString()); });
+    connect(socket, &QTcpSocket::readyRead, this, &NetClient::readFrames);
+    socket->connectToHost(host, port);
+}
+
+void NetClient::disconnectFrom()
+{
+    if (device) {
+        // no signals from a connection given up on purpose
+        device->disconnect(this);
+        device->close();
+        device->deleteLater();
+        device = nullptr;
+    }
+    buffer.clear();
+    ready = false;
+}
+
+void NetClient::lost(const QString &error)
+{
+    // an error and the disconnect after it are reported once
+    if (device) {
+        disconnectFrom();
+        emit failed(error);
+    }
+}
+
+void NetClient::send(const Message &message)
+{
+    if (!device || !ready) {
+        return;
+    }
+    std::uint8_t frame[MaxFrameSize];
+    std::size_t size = encodeMessage(message, frame);
+    device->write(reinterpret_cast<const char *>(frame), static_cast<qint64>(size));
+}
+
+void NetClient::readFrames()
+{
+    QIODevice *reading = device;
+    buffer.append(device->readAll());
+    int used = 0;
+    for (;;) {
+        Message message;
+        int size = decodeMessage(reinterpret_cast<const std::uint8_t *>(buffer.constData()) + used,
+                                 static_cast<std::size_t>(buffer.size() - used), message);
+        if (size == 0) {
+            break;
+        }
+        if (size < 0) {
+            lost("The server sent something that is not a message.");
+            return;
+        }
+        used += size;
+        emit received(message);
+        if (device != reading) {
+            return; // a receiver disconnected, or connected elsewhere
+        }
+    }
+    buffer.remove(0, used);
+}
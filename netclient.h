@@ -0,0 +1,40 @@
+// netclient.h
+#ifndef NETCLIENT_H
+#define NETCLIENT_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include "protocol.h"
+
+class QIODevice;
+
+// the game's connection to a gameserver: HOST:PORT over TCP, or the path of a Unix
+// socket; frames are cut from the stream and handed over one message at a time
+class NetClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NetClient(QObject *parent = nullptr);
+
+    void connectTo(const QString &address);
+    void disconnectFrom();
+    bool isConnected() const { return ready; }
+    void send(const Message &message);
+
+signals:
+    void connected();
+    void received(const Message &message);
+    void failed(const QString &error); // also when the server goes away
+
+private:
+    void readFrames();
+    void lost(const QString &error);
+
+    QIODevice *device = nullptr; // a QTcpSocket or a QLocalSocket
+    QByteArray buffer;
+    bool ready = false;
+};
+
+#endif // NETCLIENT_H
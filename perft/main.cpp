@@ -0,0 +1,170 @@
+// main.cpp
+// perft: counts the positions reachable from the opening setup
+//
+//   perft [depth] [--divide] [--check]
+//
+// --divide prints the count below every root action of the last depth,
+// --check compares the generator with checkMove/applyAbility at every node
+// and checks that takeBack restores every position exactly
+#include "movegen.h"
+#include "record.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <tuple>
+
+struct PerftCount {
+    unsigned long long nodes = 0;      // positions at the requested depth
+    unsigned long long moves = 0;      // ... reached by a plain move
+    unsigned long long abilities = 0;  // ... reached by a special ability
+    unsigned long long terminal = 0;   // games over before the requested depth
+
+    PerftCount &operator+=(const PerftCount &o) {
+        nodes += o.nodes;
+        moves += o.moves;
+        abilities += o.abilities;
+        terminal += o.terminal;
+        return *this;
+    }
+};
+
+static bool checkNodes = false;
+
+// brute force over every square pair, the slow reference for the generator
+static bool matchesReference(const BoardState &state, const ActionList &list)
+{
+    ActionList reference;
+    for (int from = 0; from < BoardSquares; ++from) {
+        for (int to = 0; to < BoardSquares; ++to) {
+            if (checkMove(state, from % BoardCols, from / BoardCols, to % BoardCols, to / BoardCols) == RuleError::None) {
+                reference.push(from, to, false);
+            }
+        }
+        BoardState copy = state;
+        if (applyAbility(copy, from % BoardCols, from / BoardCols)) {
+            reference.push(from, from, true);
+        }
+    }
+
+    auto order = [](const Action &a, const Action &b) {
+        return std::make_tuple(a.from, a.to, a.isAbility) < std::make_tuple(b.from, b.to, b.isAbility);
+    };
+    ActionList generated = list;
+    std::sort(generated.actions, generated.actions + generated.size, order);
+    std::sort(reference.actions, reference.actions + reference.size, order);
+    return generated.size == reference.size && std::equal(generated.begin(), generated.end(), reference.begin());
+}
+
+// everything takeBack has to restore
+static bool samePosition(const BoardState &a, const BoardState &b)
+{
+    for (int sq = 0; sq < BoardSquares; ++sq) {
+        const PieceState &x = a.squares[sq];
+        const PieceState &y = b.squares[sq];
+        if (x.type != y.type || x.isPlayerOne != y.isPlayerOne || x.abilityUsesLeft != y.abilityUsesLeft) {
+            return false;
+        }
+    }
+    for (int side = 0; side < 2; ++side) {
+        for (int type = 0; type < PieceTypeCount; ++type) {
+            if (a.pieces[side][type] != b.pieces[side][type]) {
+                return false;
+            }
+        }
+        if (a.occupancy[side] != b.occupancy[side] || a.pieceCount[side] != b.pieceCount[side]
+            || a.kingCount[side] != b.kingCount[side]) {
+            return false;
+        }
+    }
+    return a.hash == b.hash && a.currentPlayer == b.currentPlayer && a.result == b.result && a.plyCount == b.plyCount;
+}
+
+static bool takeBackRestores(BoardState &state, const ActionList &list)
+{
+    BoardState before = state;
+    for (const Action &action : list) {
+        UndoRecord undo;
+        makeAction(state, action, undo);
+        takeBack(state, undo);
+        if (!samePosition(state, before)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// walks the tree in place with makeAction and takeBack
+static PerftCount perft(BoardState &state, int depth)
+{
+    PerftCount count;
+    ActionList list;
+    generateActions(state, list);
+    if (checkNodes && (!matchesReference(state, list) || !takeBackRestores(state, list))) {
+        std::fprintf(stderr, "generator or takeBack mismatch at ply %d\n", state.plyCount);
+        std::exit(1);
+    }
+    if (list.size == 0) {
+        count.terminal = 1;
+        return count;
+    }
+
+    for (const Action &action : list) {
+        if (depth == 1) {
+            ++count.nodes;
+            ++(action.isAbility ? count.abilities : count.moves);
+            continue;
+        }
+        UndoRecord undo;
+        makeAction(state, action, undo);
+        count += perft(state, depth - 1);
+        takeBack(state, undo);
+    }
+    return count;
+}
+
+static void printAction(const Action &action)
+{
+    std::printf("%-8s", actionNotation(action).c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    int maxDepth = 4;
+    bool divide = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--divide") == 0) {
+            divide = true;
+        } else if (std::strcmp(argv[i], "--check") == 0) {
+            checkNodes = true;
+        } else if (std::atoi(argv[i]) > 0) {
+            maxDepth = std::atoi(argv[i]);
+        } else {
+            std::fprintf(stderr, "usage: perft [depth] [--divide] [--check]\n");
+            return 2;
+        }
+    }
+
+    BoardState start = initialBoardState();
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        auto begin = std::chrono::steady_clock::now();
+        PerftCount count = perft(start, depth);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        double rate = seconds > 0 ? count.nodes / seconds : 0;
+        std::printf("depth %d  nodes %llu  moves %llu  abilities %llu  terminal %llu  %.3fs  %.0f nodes/s\n",
+                    depth, count.nodes, count.moves, count.abilities, count.terminal, seconds, rate);
+    }
+
+    if (divide) {
+        ActionList list;
+        generateActions(start, list);
+        for (const Action &action : list) {
+            BoardState next = start;
+            applyAction(next, action);
+            printAction(action);
+            std::printf(" %llu\n", maxDepth > 1 ? perft(next, maxDepth - 1).nodes : 1ULL);
+        }
+    }
+    return 0;
+}
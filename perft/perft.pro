@@ -0,0 +1,10 @@
+# perft.pro
+# node counts of the move generator from the opening position
+TEMPLATE = app
+TARGET = perft
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
@@ -7,83 +7,33 @@
 #include <QBrush>
 #include <QColor>
 #include "terrain.h"
+#include "rules.h"
+#include "pool.h"
 
-// base for piece
+// base for piece: only the drawing, the rules live in rules.h;
+// the items live in a PiecePool and are set up again for every piece they show
 class Piece : public QGraphicsEllipseItem {
 public:
-    int x, y;          // grid location
-    bool isPlayerOne;  // the belonging of the piece
-    virtual ~Piece() {}
-    virtual bool specialAbility(QGraphicsScene *scene) = 0;  // whether the special ability used successfully
+    int x = 0, y = 0;                  // grid location
+    bool isPlayerOne = false;          // the belonging of the piece
+    PieceType type = PieceType::None;  // type tag, no dynamic_cast needed
     std::string getSpecialAbilityText() const {
             return specialAbilityText;
         }
     QString name = "Piece";
-    bool isKingCaptured(QGraphicsScene *scene);
-    Piece(int x, int y, bool isPlayerOne, QColor color, QGraphicsScene *scene);
-    void moveTo(int destX, int destY, QGraphicsScene *scene);
-    int getErrorCase() const { return error_case; };
+    Piece();
+
+    // shows the item on the scene as the given piece
+    void setup(PieceType type, int x, int y, bool isPlayerOne, QGraphicsScene *scene);
+    void moveTo(int destX, int destY);
 
 protected:
     std::string specialAbilityText; // description of the special ability
-private:
-    int error_case = 0;
-};
-
-
-class Knight : public Piece {
-public:
-    Knight(int x, int y, bool isPlayerOne, QGraphicsScene *scene);
-    bool specialAbility(QGraphicsScene *scene) override;
-    bool isUsingSpecialAbility = false;
-    void moveTo(QGraphicsScene *scene,int destX,int destY);
-private:
-    bool hasCharged = false;
-
-
-};
-
-
-class Pawn : public Piece {
-public:
-    Pawn(int x, int y, bool isPlayerOne, QGraphicsScene *scene);
-    bool specialAbility(QGraphicsScene *scene) override;
-
 };
 
-
-class Bomb : public Piece {
-public:
-    Bomb(int x, int y, bool isPlayerOne, QGraphicsScene *scene);
-    bool specialAbility(QGraphicsScene *scene) override;
-
-};
-
-
-class Queen : public Piece {
-public:
-    Queen(int x, int y, bool isPlayerOne, QGraphicsScene *scene);
-    bool specialAbility(QGraphicsScene *scene) override;
-
-};
-
-
-class King : public Piece {
-public:
-    King(int x, int y, bool isPlayerOne, QGraphicsScene *scene);
-    bool specialAbility(QGraphicsScene *scene) override;
-    bool hasUsedAbility = false;
-
-};
-
-
-class Bishop : public Piece {
-public:
-    Bishop(int x, int y, bool isPlayerOne, QGraphicsScene *scene);
-    bool specialAbility(QGraphicsScene *scene) override;
-
-private:
-    int abilityUsesLeft = 2;
-};
+// a board never holds more pieces than squares, Bishop spawns included,
+// so one item per square covers every game without allocating
+using PiecePool = HandlePool<Piece, BoardSquares>;
+using PieceHandle = PoolHandle;
 
 #endif // PIECE_H
@@ -0,0 +1,88 @@
+// pool.h
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstdint>
+
+// slot index and generation; releasing a slot moves its generation on,
+// so a handle kept past the release stops resolving instead of dangling
+struct PoolHandle {
+    static const std::uint16_t None = 0xFFFF;
+
+    std::uint16_t index = None;
+    std::uint16_t generation = 0;
+
+    bool valid() const { return index != None; }
+    bool operator==(const PoolHandle &o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const PoolHandle &o) const { return !(*this == o); }
+};
+
+// fixed-capacity arena: the objects are built once with the pool and reused,
+// acquire and release only move slot numbers on a free list
+template <typename T, int Capacity>
+class HandlePool {
+    static_assert(Capacity > 0 && Capacity < PoolHandle::None, "handles index the slots with 16 bits");
+
+public:
+    HandlePool() { clear(); }
+    HandlePool(const HandlePool &) = delete;
+    HandlePool &operator=(const HandlePool &) = delete;
+
+    // an invalid handle when every slot is taken; the slot keeps what its last user left
+    PoolHandle acquire() {
+        PoolHandle handle;
+        if (freeCount == 0) {
+            return handle;
+        }
+        handle.index = freeSlots[--freeCount];
+        handle.generation = generations[handle.index];
+        live[handle.index] = true;
+        return handle;
+    }
+
+    // stale and invalid handles are ignored
+    void release(PoolHandle handle) {
+        if (!get(handle)) {
+            return;
+        }
+        live[handle.index] = false;
+        ++generations[handle.index];
+        freeSlots[freeCount++] = handle.index;
+    }
+
+    // every slot free, every handle out there stale
+    void clear() {
+        freeCount = 0;
+        for (int i = Capacity - 1; i >= 0; --i) {
+            if (live[i]) {
+                live[i] = false;
+                ++generations[i];
+            }
+            freeSlots[freeCount++] = static_cast<std::uint16_t>(i);
+        }
+    }
+
+    // nullptr once the slot was released
+    T *get(PoolHandle handle) {
+        return resolves(handle) ? &slots[handle.index] : nullptr;
+    }
+    const T *get(PoolHandle handle) const {
+        return resolves(handle) ? &slots[handle.index] : nullptr;
+    }
+
+    int size() const { return Capacity - freeCount; }
+    static constexpr int capacity() { return Capacity; }
+
+private:
+    bool resolves(PoolHandle handle) const {
+        return handle.index < Capacity && live[handle.index] && generations[handle.index] == handle.generation;
+    }
+
+    T slots[Capacity];
+    std::uint16_t generations[Capacity] = {};
+    std::uint16_t freeSlots[Capacity];
+    bool live[Capacity] = {};
+    int freeCount = 0;
+};
+
+#endif // POOL_H
@@ -0,0 +1,274 @@
+// posdb.cpp
+#include "posdb.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const char DatabaseMagic[4] = {'C', 'G', 'D', 'B'};
+
+bool fail(std::string *error, const std::string &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+std::size_t align8(std::size_t size)
+{
+    return (size + 7) & ~std::size_t(7);
+}
+
+// byte offsets of the columns, every column starts 8-aligned
+struct Layout {
+    std::size_t keys, games, plies, results, lengths, nameOffsets, names, size;
+};
+
+Layout layout(std::uint64_t gameCount, std::uint64_t positionCount, std::uint64_t namesSize)
+{
+    Layout at;
+    at.keys = align8(sizeof(DatabaseHeader));
+    at.games = at.keys + positionCount * sizeof(std::uint64_t);
+    at.plies = align8(at.games + positionCount * sizeof(std::uint32_t));
+    at.results = align8(at.plies + positionCount * sizeof(std::uint16_t));
+    at.lengths = align8(at.results + gameCount);
+    at.nameOffsets = align8(at.lengths + gameCount * sizeof(std::uint16_t));
+    at.names = at.nameOffsets + (gameCount + 1) * sizeof(std::uint32_t);
+    at.size = at.names + namesSize;
+    return at;
+}
+
+struct Row {
+    std::uint64_t key;
+    std::uint32_t game;
+    std::uint16_t ply;
+};
+
+struct GameEntry {
+    std::string path;
+    bool accepted = false;
+    GameResult result = GameResult::Ongoing;
+    std::uint16_t length = 0;
+};
+
+// every position of one game once, at its first visit; false when the record is
+// not on the standard terrain or does not replay
+bool collectGame(const std::string &path, const std::vector<TerrainType> &standardTerrain,
+                 std::uint32_t game, std::vector<Row> &rows, GameEntry &entry)
+{
+    GameRecord record;
+    BoardState state;
+    if (!loadRecordFile(path, record) || record.start.terrain != standardTerrain
+        || !scenarioToState(record.start, state)) {
+        return false;
+    }
+    std::size_t first = rows.size();
+    rows.push_back({state.hash, game, 0});
+    for (std::size_t i = 0; i < record.actions.size(); ++i) {
+        if (!applyAction(state, record.actions[i])) {
+            rows.resize(first);
+            return false;
+        }
+        rows.push_back({state.hash, game, static_cast<std::uint16_t>(std::min<std::size_t>(i + 1, 0xFFFF))});
+    }
+    std::sort(rows.begin() + first, rows.end(), [](const Row &a, const Row &b) {
+        return a.key != b.key ? a.key < b.key : a.ply < b.ply;
+    });
+    rows.erase(std::unique(rows.begin() + first, rows.end(),
+                           [](const Row &a, const Row &b) { return a.key == b.key; }), rows.end());
+    entry.result = state.result;
+    entry.length = static_cast<std::uint16_t>(std::min<std::size_t>(record.actions.size(), 0xFFFF));
+    entry.accepted = true;
+    return true;
+}
+
+template <typename T>
+void writeColumn(std::FILE *out, const T *values, std::size_t count, std::size_t at)
+{
+    // zero padding up to the column
+    static const char zeros[8] = {};
+    long position = std::ftell(out);
+    std::fwrite(zeros, 1, at - static_cast<std::size_t>(position), out);
+    std::fwrite(values, sizeof(T), count, out);
+}
+
+} // namespace
+
+bool PositionDatabase::open(const std::string &path, std::string *error)
+{
+    header = nullptr;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    if (file.size() < sizeof(DatabaseHeader) || std::memcmp(file.data(), DatabaseMagic, sizeof(DatabaseMagic)) != 0) {
+        return fail(error, path + " is not a position database");
+    }
+    const DatabaseHeader *head = reinterpret_cast<const DatabaseHeader *>(file.data());
+    if (head->cols != BoardCols || head->rows != BoardRows) {
+        return fail(error, path + " is for another board size");
+    }
+    Layout at = layout(head->gameCount, head->positionCount, head->namesSize);
+    if (file.size() < at.size) {
+        return fail(error, path + " is truncated");
+    }
+    const std::uint8_t *base = file.data();
+    keys = reinterpret_cast<const std::uint64_t *>(base + at.keys);
+    games = reinterpret_cast<const std::uint32_t *>(base + at.games);
+    plies = reinterpret_cast<const std::uint16_t *>(base + at.plies);
+    results = base + at.results;
+    lengths = reinterpret_cast<const std::uint16_t *>(base + at.lengths);
+    nameOffsets = reinterpret_cast<const std::uint32_t *>(base + at.nameOffsets);
+    names = reinterpret_cast<const char *>(base + at.names);
+    header = head;
+    return true;
+}
+
+PositionStats PositionDatabase::lookup(std::uint64_t key, std::vector<PositionGame> *found, std::size_t maxGames) const
+{
+    PositionStats stats;
+    if (!header) {
+        return stats;
+    }
+    const std::uint64_t *end = keys + header->positionCount;
+    const std::uint64_t *row = std::lower_bound(keys, end, key);
+    for (; row != end && *row == key; ++row) {
+        std::size_t i = static_cast<std::size_t>(row - keys);
+        ++stats.games;
+        ++stats.results[results[games[i]]];
+        if (found && found->size() < maxGames) {
+            found->push_back({games[i], plies[i]});
+        }
+    }
+    return stats;
+}
+
+std::string PositionDatabase::gameName(std::uint32_t game) const
+{
+    return std::string(names + nameOffsets[game], names + nameOffsets[game + 1]);
+}
+
+bool buildPositionDatabase(const std::vector<std::string> &paths, const std::string &output, int threads,
+                           DatabaseBuildStats *stats, std::string *error)
+{
+    std::vector<std::string> files;
+    if (!listRecordFiles(paths, files, error)) {
+        return false;
+    }
+    std::vector<GameEntry> entries(files.size());
+    for (std::size_t game = 0; game < files.size(); ++game) {
+        entries[game].path = files[game];
+    }
+    if (entries.size() >= 0xFFFFFFFFu) {
+        return fail(error, "too many games");
+    }
+
+    // replayed in parallel, each thread with its own rows
+    const std::vector<TerrainType> standardTerrain = scenarioFromState(initialBoardState()).terrain;
+    std::vector<std::vector<Row>> threadRows(std::max(1, threads));
+    std::atomic<std::size_t> next{0};
+    auto work = [&](int id) {
+        for (std::size_t game = next++; game < entries.size(); game = next++) {
+            collectGame(entries[game].path, standardTerrain, static_cast<std::uint32_t>(game), threadRows[id], entries[game]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int id = 1; id < static_cast<int>(threadRows.size()); ++id) {
+        workers.emplace_back(work, id);
+    }
+    work(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // skipped games leave no gap in the numbering
+    std::vector<std::uint32_t> number(entries.size());
+    std::vector<std::uint8_t> results;
+    std::vector<std::uint16_t> lengths;
+    std::vector<std::uint32_t> nameOffsets(1, 0);
+    std::string names;
+    for (std::size_t game = 0; game < entries.size(); ++game) {
+        const GameEntry &entry = entries[game];
+        if (!entry.accepted) {
+            continue;
+        }
+        number[game] = static_cast<std::uint32_t>(results.size());
+        results.push_back(static_cast<std::uint8_t>(entry.result));
+        lengths.push_back(entry.length);
+        names += entry.path;
+        nameOffsets.push_back(static_cast<std::uint32_t>(names.size()));
+    }
+
+    std::vector<Row> rows;
+    std::size_t total = 0;
+    for (const auto &part : threadRows) {
+        total += part.size();
+    }
+    rows.reserve(total);
+    for (auto &part : threadRows) {
+        for (Row &row : part) {
+            row.game = number[row.game];
+            rows.push_back(row);
+        }
+        std::vector<Row>().swap(part);
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+        return a.key != b.key ? a.key < b.key : a.game < b.game;
+    });
+
+    DatabaseHeader head = {};
+    std::memcpy(head.magic, DatabaseMagic, sizeof(DatabaseMagic));
+    head.cols = BoardCols;
+    head.rows = BoardRows;
+    head.gameCount = results.size();
+    head.positionCount = rows.size();
+    head.namesSize = names.size();
+    Layout at = layout(head.gameCount, head.positionCount, head.namesSize);
+
+    std::FILE *out = std::fopen(output.c_str(), "wb");
+    if (!out) {
+        return fail(error, "cannot write " + output);
+    }
+    std::fwrite(&head, sizeof(head), 1, out);
+    // one column at a time, from a scratch buffer
+    {
+        std::vector<std::uint64_t> column(rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            column[i] = rows[i].key;
+        }
+        writeColumn(out, column.data(), column.size(), at.keys);
+    }
+    {
+        std::vector<std::uint32_t> column(rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            column[i] = rows[i].game;
+        }
+        writeColumn(out, column.data(), column.size(), at.games);
+    }
+    {
+        std::vector<std::uint16_t> column(rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            column[i] = rows[i].ply;
+        }
+        writeColumn(out, column.data(), column.size(), at.plies);
+    }
+    writeColumn(out, results.data(), results.size(), at.results);
+    writeColumn(out, lengths.data(), lengths.size(), at.lengths);
+    writeColumn(out, nameOffsets.data(), nameOffsets.size(), at.nameOffsets);
+    writeColumn(out, names.data(), names.size(), at.names);
+    bool written = std::ferror(out) == 0;
+    written = std::fclose(out) == 0 && written;
+    if (!written) {
+        return fail(error, "cannot write " + output);
+    }
+
+    if (stats) {
+        stats->games = head.gameCount;
+        stats->positions = head.positionCount;
+        stats->skipped = entries.size() - head.gameCount;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+// posdb.h
+#ifndef POSDB_H
+#define POSDB_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "record.h"
+#include "scenario.h"
+
+// every position of a set of games on the standard terrain, for "which games went
+// through here and how did they end". Columnar file (.cgdb), read through mmap:
+//   DatabaseHeader
+//   keys[positions]      Zobrist keys, sorted: the index
+//   games[positions]     game of each key, ascending within a key
+//   plies[positions]     actions played before the position
+//   results[games]       GameResult at the end of the record, Ongoing when it was cut off
+//   lengths[games]       actions in the record
+//   nameOffsets[games+1] into names, the record file of every game
+//   names
+// a game that comes back to a position is listed once, at the first visit
+
+struct DatabaseHeader {
+    char magic[4];              // "CGDB"
+    std::uint16_t cols;
+    std::uint16_t rows;
+    std::uint64_t gameCount;
+    std::uint64_t positionCount;
+    std::uint64_t namesSize;
+};
+
+struct PositionStats {
+    std::uint32_t games = 0;
+    std::uint32_t results[4] = {}; // by GameResult
+};
+
+// one game through the position
+struct PositionGame {
+    std::uint32_t game;
+    std::uint16_t ply;
+};
+
+class PositionDatabase {
+public:
+    bool open(const std::string &path, std::string *error = nullptr);
+
+    std::uint64_t gameCount() const { return header ? header->gameCount : 0; }
+    std::uint64_t positionCount() const { return header ? header->positionCount : 0; }
+
+    // binary search over the key column; games, when given, gets up to maxGames of them
+    PositionStats lookup(std::uint64_t key, std::vector<PositionGame> *games = nullptr,
+                         std::size_t maxGames = SIZE_MAX) const;
+
+    GameResult gameResult(std::uint32_t game) const { return static_cast<GameResult>(results[game]); }
+    int gameLength(std::uint32_t game) const { return lengths[game]; }
+    std::string gameName(std::uint32_t game) const;
+    std::uint64_t keyAt(std::uint64_t row) const { return keys[row]; }
+
+private:
+    MappedFile file;
+    const DatabaseHeader *header = nullptr;
+    const std::uint64_t *keys = nullptr;
+    const std::uint32_t *games = nullptr;
+    const std::uint16_t *plies = nullptr;
+    const std::uint8_t *results = nullptr;
+    const std::uint16_t *lengths = nullptr;
+    const std::uint32_t *nameOffsets = nullptr;
+    const char *names = nullptr;
+};
+
+struct DatabaseBuildStats {
+    std::uint64_t games = 0;
+    std::uint64_t positions = 0;
+    std::uint64_t skipped = 0;      // other terrain, or a record that does not replay
+};
+
+// replays the records on the given number of threads and writes the database;
+// paths are record files or directories of .cgr files
+bool buildPositionDatabase(const std::vector<std::string> &paths, const std::string &output, int threads,
+                           DatabaseBuildStats *stats = nullptr, std::string *error = nullptr);
+
+#endif // POSDB_H
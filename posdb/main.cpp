@@ -0,0 +1,165 @@
+// main.cpp
+// posdb: every position of a set of recorded games, and the games through a position
+//
+//   posdb build OUT PATH... [--threads N]
+//   posdb query DB [--record FILE [--ply N] | --scenario FILE] [--list K] [--bench]
+//
+// build replays the records (files, or directories of .cgr files) on every core and
+// writes the database; games that do not start on the standard terrain are skipped.
+// query looks up the standard start, the position after N actions of a record, or a
+// scenario, and prints how the games through it ended; --list prints the first K of
+// them, --bench times lookups of keys taken from the database
+#include "posdb.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char *resultName(GameResult result)
+{
+    switch (result) {
+    case GameResult::PlayerOneWins: return "Player 1 wins";
+    case GameResult::PlayerTwoWins: return "Player 2 wins";
+    case GameResult::Draw:          return "draw";
+    default:                        return "unfinished";
+    }
+}
+
+static int usage()
+{
+    std::fprintf(stderr, "usage: posdb build OUT PATH... [--threads N]\n"
+                         "       posdb query DB [--record FILE [--ply N] | --scenario FILE] [--list K] [--bench]\n");
+    return 2;
+}
+
+static int build(int argc, char *argv[])
+{
+    const char *output = nullptr;
+    std::vector<std::string> paths;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (!output) {
+            output = argv[i];
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (!output || paths.empty()) {
+        return usage();
+    }
+
+    DatabaseBuildStats stats;
+    std::string error;
+    auto begin = std::chrono::steady_clock::now();
+    if (!buildPositionDatabase(paths, output, threads, &stats, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("%llu games, %llu positions, %llu skipped in %.2f s\n", static_cast<unsigned long long>(stats.games),
+                static_cast<unsigned long long>(stats.positions), static_cast<unsigned long long>(stats.skipped), seconds);
+    return 0;
+}
+
+static int query(int argc, char *argv[])
+{
+    const char *path = argc > 2 ? argv[2] : nullptr;
+    const char *recordPath = nullptr;
+    const char *scenarioPath = nullptr;
+    int ply = -1;
+    std::size_t list = 0;
+    bool bench = false;
+    for (int i = 3; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ply") == 0 && hasValue) {
+            ply = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--scenario") == 0 && hasValue) {
+            scenarioPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--list") == 0 && hasValue) {
+            list = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            return usage();
+        }
+    }
+    if (!path || (recordPath && scenarioPath)) {
+        return usage();
+    }
+
+    PositionDatabase database;
+    std::string error;
+    if (!database.open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    BoardState state = initialBoardState();
+    if (recordPath) {
+        GameRecord record;
+        if (!loadRecordFile(recordPath, record, &error) || !replayRecord(record, ply, state, &error)) {
+            std::fprintf(stderr, "%s: %s\n", recordPath, error.c_str());
+            return 1;
+        }
+    } else if (scenarioPath) {
+        Scenario scenario;
+        if (!loadScenarioFile(scenarioPath, scenario, &error) || !scenarioToState(scenario, state, &error)) {
+            std::fprintf(stderr, "%s: %s\n", scenarioPath, error.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<PositionGame> games;
+    auto begin = std::chrono::steady_clock::now();
+    PositionStats stats = database.lookup(state.hash, &games, list);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("position %016llx: %u of %llu games, Player 1 %u, Player 2 %u, draws %u, unfinished %u (%.1f us)\n",
+                static_cast<unsigned long long>(state.hash), stats.games,
+                static_cast<unsigned long long>(database.gameCount()),
+                stats.results[static_cast<int>(GameResult::PlayerOneWins)],
+                stats.results[static_cast<int>(GameResult::PlayerTwoWins)],
+                stats.results[static_cast<int>(GameResult::Draw)],
+                stats.results[static_cast<int>(GameResult::Ongoing)], 1e6 * seconds);
+    for (const PositionGame &game : games) {
+        std::printf("  %s ply %d of %d, %s\n", database.gameName(game.game).c_str(), game.ply,
+                    database.gameLength(game.game), resultName(database.gameResult(game.game)));
+    }
+
+    if (bench && database.positionCount() > 0) {
+        // keys of the database, so every lookup finds its games
+        const int rounds = 1000000;
+        std::mt19937_64 random(1);
+        std::vector<std::uint64_t> keys(4096);
+        for (std::uint64_t &key : keys) {
+            key = database.keyAt(random() % database.positionCount());
+        }
+        std::uint64_t found = 0;
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            found += database.lookup(keys[i % keys.size()]).games;
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("lookup %.0f ns, %.1f games per key\n", 1e9 * seconds / rounds, static_cast<double>(found) / rounds);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::strcmp(argv[1], "build") == 0) {
+        return build(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "query") == 0) {
+        return query(argc, argv);
+    }
+    return usage();
+}
@@ -0,0 +1,10 @@
+# posdb.pro
+# builds and queries the position database of recorded games
+TEMPLATE = app
+TARGET = posdb
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
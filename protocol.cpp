@@ -0,0 +1,159 @@
+// protocol.cpp
+#include "protocol.h"
+
+namespace {
+
+class Writer {
+public:
+    explicit Writer(std::uint8_t *out) : out(out), at(2) {}
+    void u8(std::uint8_t value) { out[at++] = value; }
+    void u16(std::uint16_t value) { u8(value & 0xFF); u8(value >> 8); }
+    void u32(std::uint32_t value) { u16(value & 0xFFFF); u16(value >> 16); }
+    void u64(std::uint64_t value) { u32(value & 0xFFFFFFFFu); u32(value >> 32); }
+    std::size_t finish() {
+        out[0] = static_cast<std::uint8_t>((at - 2) & 0xFF);
+        out[1] = static_cast<std::uint8_t>((at - 2) >> 8);
+        return at;
+    }
+
+private:
+    std::uint8_t *out;
+    std::size_t at;
+};
+
+class Reader {
+public:
+    Reader(const std::uint8_t *data, std::size_t size) : data(data), size(size) {}
+    bool u8(std::uint8_t &value) {
+        if (at >= size) {
+            return false;
+        }
+        value = data[at++];
+        return true;
+    }
+    bool u16(std::uint16_t &value) {
+        std::uint8_t low, high;
+        if (!u8(low) || !u8(high)) {
+            return false;
+        }
+        value = static_cast<std::uint16_t>(low | (high << 8));
+        return true;
+    }
+    bool u32(std::uint32_t &value) {
+        std::uint16_t low, high;
+        if (!u16(low) || !u16(high)) {
+            return false;
+        }
+        value = low | (std::uint32_t(high) << 16);
+        return true;
+    }
+    bool u64(std::uint64_t &value) {
+        std::uint32_t low, high;
+        if (!u32(low) || !u32(high)) {
+            return false;
+        }
+        value = low | (std::uint64_t(high) << 32);
+        return true;
+    }
+    bool atEnd() const { return at == size; }
+
+private:
+    const std::uint8_t *data;
+    std::size_t size;
+    std::size_t at = 0;
+};
+
+} // namespace
+
+std::size_t encodeMessage(const Message &message, std::uint8_t *out)
+{
+    Writer writer(out);
+    writer.u8(static_cast<std::uint8_t>(message.type));
+    switch (message.type) {
+    case MessageType::Create:
+        break;
+    case MessageType::Join:
+    case MessageType::Leave:
+    case MessageType::Started:
+        writer.u32(message.match);
+        break;
+    case MessageType::Play:
+        writer.u32(message.match);
+        writer.u16(message.code);
+        break;
+    case MessageType::Ping:
+    case MessageType::Pong:
+        writer.u64(message.token);
+        break;
+    case MessageType::Joined:
+    case MessageType::Left:
+        writer.u32(message.match);
+        writer.u8(message.seat);
+        break;
+    case MessageType::Played:
+        writer.u32(message.match);
+        writer.u16(message.ply);
+        writer.u16(message.code);
+        writer.u8(message.result);
+        break;
+    case MessageType::Refused:
+        writer.u32(message.match);
+        writer.u8(message.reason);
+        break;
+    }
+    return writer.finish();
+}
+
+int decodeMessage(const std::uint8_t *data, std::size_t size, Message &message)
+{
+    if (size < 2) {
+        return 0;
+    }
+    std::size_t length = data[0] | (data[1] << 8);
+    if (length == 0 || length > MaxFrameSize - 2) {
+        return -1;
+    }
+    if (size < length + 2) {
+        return 0;
+    }
+
+    Reader reader(data + 2, length);
+    std::uint8_t type = 0;
+    reader.u8(type);
+    message = Message();
+    message.type = static_cast<MessageType>(type);
+    bool read;
+    switch (message.type) {
+    case MessageType::Create:
+        read = true;
+        break;
+    case MessageType::Join:
+    case MessageType::Leave:
+    case MessageType::Started:
+        read = reader.u32(message.match);
+        break;
+    case MessageType::Play:
+        read = reader.u32(message.match) && reader.u16(message.code);
+        break;
+    case MessageType::Ping:
+    case MessageType::Pong:
+        read = reader.u64(message.token);
+        break;
+    case MessageType::Joined:
+    case MessageType::Left:
+        read = reader.u32(message.match) && reader.u8(message.seat);
+        break;
+    case MessageType::Played:
+        read = reader.u32(message.match) && reader.u16(message.ply) && reader.u16(message.code)
+            && reader.u8(message.result);
+        break;
+    case MessageType::Refused:
+        read = reader.u32(message.match) && reader.u8(message.reason);
+        break;
+    default:
+        read = false;
+        break;
+    }
+    // a frame longer than its message is as wrong as a short one
+    return read && reader.atEnd() ? static_cast<int>(length + 2) : -1;
+}
@@ -0,0 +1,67 @@
+// protocol.h
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// binary protocol of the game server, over a TCP or a Unix stream socket.
+// A frame is a little-endian 16-bit length of the rest, the message type, then
+// its fields, little-endian too; an action travels as its encodeAction() code.
+// Every match starts from the standard setup, the seat is the player number
+//
+//   client to server                     server to client
+//   Create                               Joined   match seat
+//   Join     match                       Started  match          both seats taken
+//   Play     match code                  Played   match ply code result, to both seats
+//   Leave    match                       Left     match seat     to the other seat
+//   Ping     token                       Refused  match reason
+//                                        Pong     token
+
+enum class MessageType : std::uint8_t {
+    Create = 1,
+    Join,
+    Play,
+    Leave,
+    Ping,
+    Joined = 64,
+    Started,
+    Played,
+    Left,
+    Refused,
+    Pong
+};
+
+// why the server refused a message: a RuleError of a Play (below 128), or one of these
+enum class ServerError : std::uint8_t {
+    NoMatch = 128,      // no such match, or it is over
+    MatchFull,
+    NotSeated,          // the connection has no seat in the match
+    NotYourTurn,
+    Waiting,            // the second seat is still free
+    ServerFull,         // no room for another match
+    BadMessage,
+    StillWaiting        // a Create while the last match of the connection has no second seat
+};
+
+struct Message {
+    MessageType type = MessageType::Ping;
+    std::uint32_t match = 0;
+    std::uint8_t seat = 0;      // 1 or 2
+    std::uint16_t ply = 0;      // of the position after the action, from 1
+    std::uint16_t code = 0;     // encodeAction()
+    std::uint8_t result = 0;    // GameResult after the action
+    std::uint8_t reason = 0;    // RuleError or ServerError
+    std::uint64_t token = 0;    // Ping and Pong, echoed untouched
+};
+
+const std::size_t MaxFrameSize = 16;
+
+// the frame of message at out, which holds MaxFrameSize bytes; returns its size
+std::size_t encodeMessage(const Message &message, std::uint8_t *out);
+
+// the first frame of data: its size once it is complete, 0 while it is not,
+// -1 for a frame that is not a message
+int decodeMessage(const std::uint8_t *data, std::size_t size, Message &message);
+
+#endif // PROTOCOL_H
@@ -0,0 +1,356 @@
+// record.cpp
+#include "record.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const char RecordMagic[4] = {'C', 'G', 'R', '1'};
+const std::uint16_t AbilityOffset = 12; // (0, 0) in the 5x5 square
+
+bool fail(std::string *error, const std::string &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+bool isStandardStart(const Scenario &start)
+{
+    return encodeScenario(start) == encodeScenario(scenarioFromState(initialBoardState()));
+}
+
+// both ends of the action on the board
+bool validCode(std::uint16_t code)
+{
+    int from = code / 25;
+    int offset = code % 25;
+    return from < BoardSquares
+        && (offset == AbilityOffset
+            || BoardState::inside(from % BoardCols + offset % 5 - 2, from / BoardCols + offset / 5 - 2));
+}
+
+} // namespace
+
+std::uint16_t encodeAction(const Action &action)
+{
+    int dx = action.to % BoardCols - action.from % BoardCols;
+    int dy = action.to / BoardCols - action.from / BoardCols;
+    int offset = action.isAbility ? AbilityOffset : (dy + 2) * 5 + dx + 2;
+    return static_cast<std::uint16_t>(action.from * 25 + offset);
+}
+
+Action decodeAction(std::uint16_t code)
+{
+    int from = code / 25;
+    int offset = code % 25;
+    if (offset == AbilityOffset) {
+        return Action::ability(from);
+    }
+    int x = from % BoardCols + offset % 5 - 2;
+    int y = from / BoardCols + offset / 5 - 2;
+    return Action::move(from, BoardState::index(x, y));
+}
+
+std::string squareName(int sq)
+{
+    int x = sq % BoardCols;
+    char column = static_cast<char>(x < 26 ? 'a' + x : 'A' + x - 26);
+    return column + std::to_string(sq / BoardCols + 1);
+}
+
+std::string actionNotation(const Action &action)
+{
+    if (action.isAbility) {
+        return squareName(action.from) + "*";
+    }
+    return squareName(action.from) + "-" + squareName(action.to);
+}
+
+bool parseActionNotation(const std::string &text, Action &action)
+{
+    // one square at pos, pos moves past it
+    auto parseSquare = [&text](std::size_t &pos, int &sq) {
+        if (pos >= text.size()) {
+            return false;
+        }
+        char column = text[pos++];
+        int x = column >= 'a' && column <= 'z' ? column - 'a' : column >= 'A' && column <= 'Z' ? column - 'A' + 26 : -1;
+        int y = 0;
+        std::size_t digits = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+            y = y * 10 + (text[pos++] - '0');
+        }
+        if (pos == digits || !BoardState::inside(x, y - 1)) {
+            return false;
+        }
+        sq = BoardState::index(x, y - 1);
+        return true;
+    };
+
+    std::size_t pos = 0;
+    int from;
+    if (!parseSquare(pos, from) || pos >= text.size()) {
+        return false;
+    }
+    if (text[pos] == '*' && pos + 1 == text.size()) {
+        action = Action::ability(from);
+        return true;
+    }
+    int to;
+    if (text[pos++] != '-' || !parseSquare(pos, to) || pos != text.size()) {
+        return false;
+    }
+    int dx = to % BoardCols - from % BoardCols;
+    int dy = to / BoardCols - from / BoardCols;
+    if (dx < -2 || dx > 2 || dy < -2 || dy > 2 || from == to) {
+        return false; // no piece moves further, and the code could not hold it
+    }
+    action = Action::move(from, to);
+    return true;
+}
+
+bool replayRecord(const GameRecord &record, int plies, BoardState &state, std::string *error)
+{
+    BoardState replayed;
+    if (!scenarioToState(record.start, replayed, error)) {
+        return false;
+    }
+    int count = plies < 0 ? static_cast<int>(record.actions.size())
+                          : std::min(plies, static_cast<int>(record.actions.size()));
+    for (int i = 0; i < count; ++i) {
+        if (!applyAction(replayed, record.actions[i])) {
+            return fail(error, "ply " + std::to_string(i + 1) + ": " + actionNotation(record.actions[i]) + " is not legal");
+        }
+    }
+    state = replayed;
+    return true;
+}
+
+std::vector<std::uint8_t> encodeRecord(const GameRecord &record)
+{
+    std::vector<std::uint8_t> bytes(RecordMagic, RecordMagic + sizeof(RecordMagic));
+    std::vector<std::uint8_t> start = encodeScenario(record.start);
+    bytes.insert(bytes.end(), start.begin(), start.end());
+    for (const Action &action : record.actions) {
+        std::uint16_t code = encodeAction(action);
+        bytes.push_back(static_cast<std::uint8_t>(code & 0xFF));
+        bytes.push_back(static_cast<std::uint8_t>(code >> 8));
+    }
+    return bytes;
+}
+
+bool decodeRecord(const std::uint8_t *bytes, std::size_t size, GameRecord &record, std::string *error)
+{
+    if (size < sizeof(RecordMagic) || std::memcmp(bytes, RecordMagic, sizeof(RecordMagic)) != 0) {
+        return fail(error, "not a game record");
+    }
+    ScenarioView start;
+    if (!start.open(bytes + sizeof(RecordMagic), size - sizeof(RecordMagic), error)) {
+        return false;
+    }
+    GameRecord decoded;
+    decoded.start = scenarioFromView(start);
+    // an odd last byte is a code cut in half by a crash
+    std::size_t offset = sizeof(RecordMagic) + start.byteSize();
+    decoded.actions.reserve((size - offset) / 2);
+    for (; offset + 2 <= size; offset += 2) {
+        std::uint16_t code = static_cast<std::uint16_t>(bytes[offset] | (bytes[offset + 1] << 8));
+        if (!validCode(code)) {
+            return fail(error, "action code " + std::to_string(code) + " is off the board");
+        }
+        decoded.actions.push_back(decodeAction(code));
+    }
+    record = std::move(decoded);
+    return true;
+}
+
+std::string recordToText(const GameRecord &record)
+{
+    std::ostringstream text;
+    if (!isStandardStart(record.start)) {
+        text << scenarioToText(record.start);
+    }
+    text << "moves\n";
+    // one line per turn, an action of each player; "..." stands for Player 1
+    // when the start hands the first action to Player 2
+    int side = record.start.currentPlayer;
+    int turn = 1;
+    if (side == 2 && !record.actions.empty()) {
+        text << "1. ...";
+    }
+    for (const Action &action : record.actions) {
+        if (side == 1) {
+            text << turn << ". " << actionNotation(action);
+        } else {
+            text << ' ' << actionNotation(action) << '\n';
+            ++turn;
+        }
+        side = 3 - side;
+    }
+    if (side == 2 && !record.actions.empty()) {
+        text << '\n';
+    }
+    return text.str();
+}
+
+bool parseRecordText(const std::string &text, GameRecord &record, std::string *error)
+{
+    std::istringstream lines(text);
+    std::string line;
+    std::string head;
+    std::string tail;
+    bool inMoves = false;
+    while (std::getline(lines, line)) {
+        std::string bare = line.substr(0, line.find('#'));
+        bare.erase(0, bare.find_first_not_of(" \t\r"));
+        bare.erase(bare.find_last_not_of(" \t\r") + 1);
+        if (!inMoves && bare == "moves") {
+            inMoves = true;
+            continue;
+        }
+        (inMoves ? tail : head) += bare + '\n';
+    }
+    if (!inMoves) {
+        return fail(error, "no moves line");
+    }
+
+    GameRecord parsed;
+    if (head.find_first_not_of(" \t\r\n") == std::string::npos) {
+        parsed.start = scenarioFromState(initialBoardState());
+    } else if (!parseScenarioText(head, parsed.start, error)) {
+        return false;
+    }
+
+    // turn numbers end with '.', "..." holds the place of the first player
+    std::istringstream words(tail);
+    std::string word;
+    while (words >> word) {
+        if (word.back() == '.') {
+            continue;
+        }
+        Action action;
+        if (!parseActionNotation(word, action)) {
+            return fail(error, "bad action " + word);
+        }
+        parsed.actions.push_back(action);
+    }
+    record = std::move(parsed);
+    return true;
+}
+
+bool loadRecordFile(const std::string &path, GameRecord &record, std::string *error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return fail(error, "cannot open " + path);
+    }
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() >= sizeof(RecordMagic) && std::memcmp(bytes.data(), RecordMagic, sizeof(RecordMagic)) == 0) {
+        return decodeRecord(reinterpret_cast<const std::uint8_t *>(bytes.data()), bytes.size(), record, error);
+    }
+    return parseRecordText(bytes, record, error);
+}
+
+bool isRecordFile(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (text.size() >= sizeof(RecordMagic) && std::memcmp(text.data(), RecordMagic, sizeof(RecordMagic)) == 0) {
+        return true;
+    }
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line == "moves") {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool listRecordFiles(const std::vector<std::string> &paths, std::vector<std::string> &files, std::string *error)
+{
+    for (const std::string &path : paths) {
+        std::error_code code;
+        if (!std::filesystem::is_directory(path, code)) {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<std::string> inside;
+        for (const auto &item : std::filesystem::directory_iterator(path, code)) {
+            if (item.is_regular_file() && item.path().extension() == ".cgr") {
+                inside.push_back(item.path().string());
+            }
+        }
+        if (code) {
+            return fail(error, "cannot list " + path);
+        }
+        std::sort(inside.begin(), inside.end());
+        files.insert(files.end(), inside.begin(), inside.end());
+    }
+    return true;
+}
+
+bool RecordWriter::open(const std::string &filePath, const BoardState &start, std::string *error)
+{
+    close();
+    file = std::fopen(filePath.c_str(), "wb");
+    if (!file) {
+        return fail(error, "cannot write " + filePath);
+    }
+    path = filePath;
+    GameRecord head;
+    head.start = scenarioFromState(start);
+    std::vector<std::uint8_t> bytes = encodeRecord(head);
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fflush(file);
+    startSize = static_cast<long>(bytes.size());
+    written = 0;
+    return true;
+}
+
+void RecordWriter::write(const Action &action)
+{
+    if (!file) {
+        return;
+    }
+    std::uint16_t code = encodeAction(action);
+    const std::uint8_t bytes[2] = {static_cast<std::uint8_t>(code & 0xFF), static_cast<std::uint8_t>(code >> 8)};
+    std::fwrite(bytes, 1, sizeof(bytes), file);
+    std::fflush(file);
+    ++written;
+}
+
+bool RecordWriter::truncate(int actions, std::string *error)
+{
+    if (!file || actions >= written) {
+        return true;
+    }
+    // reopened around the resize, some systems refuse to shrink an open file
+    close();
+    std::error_code code;
+    std::filesystem::resize_file(path, static_cast<std::uintmax_t>(startSize + 2L * actions), code);
+    if (code) {
+        return fail(error, "cannot shorten " + path + ": " + code.message());
+    }
+    file = std::fopen(path.c_str(), "ab");
+    if (!file) {
+        return fail(error, "cannot reopen " + path);
+    }
+    written = actions;
+    return true;
+}
+
+void RecordWriter::close()
+{
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
@@ -0,0 +1,76 @@
+// record.h
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "movegen.h"
+#include "scenario.h"
+
+// a played game: where it started and every action since
+//
+// binary form (.cgr): the magic "CGR1", the start as a scenario record, then one
+// little-endian 16-bit code per action; a file cut short after any code is still
+// a valid record, so it is written as the game goes
+//
+// text form: the start as scenario text (left out for the standard setup), then
+//   moves
+//   1. f1-f2 f11-f10
+//   2. g1* e11-e10
+// squares are a column letter (a-z, then A-F) and the row from 1, '*' marks an ability
+
+struct GameRecord {
+    Scenario start;
+    std::vector<Action> actions;
+};
+
+// from * 25 + the target's offset in the 5x5 square around from; the centre,
+// a move that goes nowhere, is the ability. Fits 16 bits up to 32x32
+std::uint16_t encodeAction(const Action &action);
+Action decodeAction(std::uint16_t code);
+
+std::string squareName(int sq);
+std::string actionNotation(const Action &action);
+bool parseActionNotation(const std::string &text, Action &action);
+
+// the position after the first plies actions (all of them when plies < 0);
+// false with a message at the first action the rules refuse
+bool replayRecord(const GameRecord &record, int plies, BoardState &state, std::string *error = nullptr);
+
+std::vector<std::uint8_t> encodeRecord(const GameRecord &record);
+bool decodeRecord(const std::uint8_t *bytes, std::size_t size, GameRecord &record, std::string *error = nullptr);
+std::string recordToText(const GameRecord &record);
+bool parseRecordText(const std::string &text, GameRecord &record, std::string *error = nullptr);
+
+// either form, told apart by the binary magic
+bool loadRecordFile(const std::string &path, GameRecord &record, std::string *error = nullptr);
+bool isRecordFile(const std::string &path);
+// the files among paths, and the .cgr files of the directories among them in name order
+bool listRecordFiles(const std::vector<std::string> &paths, std::vector<std::string> &files,
+                     std::string *error = nullptr);
+
+// streams a game to a binary file: the start on open, then every action as it is played
+class RecordWriter {
+public:
+    RecordWriter() = default;
+    RecordWriter(const RecordWriter &) = delete;
+    RecordWriter &operator=(const RecordWriter &) = delete;
+    ~RecordWriter() { close(); }
+
+    bool open(const std::string &path, const BoardState &start, std::string *error = nullptr);
+    bool isOpen() const { return file != nullptr; }
+    void write(const Action &action); // flushed, a crash loses nothing
+    // forget the actions after the first ones, for takebacks; on failure the writer is closed
+    bool truncate(int actions, std::string *error = nullptr);
+    void close();
+
+private:
+    std::FILE *file = nullptr;
+    std::string path;
+    long startSize = 0; // bytes before the first action
+    int written = 0;
+};
+
+#endif // RECORD_H
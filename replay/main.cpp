@@ -0,0 +1,109 @@
+// main.cpp
+// replay: game records in both forms
+//
+//   replay FILE [--ply N] [--convert OUT] [--bench]
+//
+// prints the record as text and how the game stands at its end;
+// --ply N prints the position after N actions as a scenario, to start a game from it,
+// --convert writes the record to OUT, binary for .cgr and text otherwise,
+// --bench times rebuilding the last position from the start
+#include "record.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static const char *resultName(GameResult result)
+{
+    switch (result) {
+    case GameResult::PlayerOneWins: return "Player 1 wins";
+    case GameResult::PlayerTwoWins: return "Player 2 wins";
+    case GameResult::Draw:          return "draw";
+    default:                        return "ongoing";
+    }
+}
+
+static bool writeRecord(const GameRecord &record, const std::string &path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".cgr") == 0) {
+        std::vector<std::uint8_t> bytes = encodeRecord(record);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    } else {
+        file << recordToText(record);
+    }
+    if (!file) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    const char *convert = nullptr;
+    int ply = -1;
+    bool bench = false;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--ply") == 0 && hasValue) {
+            ply = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--convert") == 0 && hasValue) {
+            convert = argv[++i];
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        std::fprintf(stderr, "usage: replay FILE [--ply N] [--convert OUT] [--bench]\n");
+        return 2;
+    }
+
+    GameRecord record;
+    std::string error;
+    if (!loadRecordFile(path, record, &error)) {
+        std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return 1;
+    }
+    BoardState state;
+    if (!replayRecord(record, ply, state, &error)) {
+        std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return 1;
+    }
+
+    if (convert) {
+        return writeRecord(record, convert) ? 0 : 1;
+    }
+    if (ply >= 0) {
+        std::printf("%s", scenarioToText(scenarioFromState(state)).c_str());
+        return 0;
+    }
+
+    std::printf("%s", recordToText(record).c_str());
+    std::printf("# %zu actions, %zu bytes as binary, %s, hash %016llx\n", record.actions.size(),
+                encodeRecord(record).size(), resultName(state.result), static_cast<unsigned long long>(state.hash));
+
+    if (bench) {
+        const int rounds = 10000;
+        std::uint64_t check = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            BoardState end;
+            replayRecord(record, -1, end);
+            check ^= end.hash;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("# replay %.2f us per game, %.0f ns per action%s\n", 1e6 * seconds / rounds,
+                    record.actions.empty() ? 0.0 : 1e9 * seconds / rounds / record.actions.size(),
+                    check == (rounds % 2 ? state.hash : 0) ? "" : " (mismatch)");
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+# replay.pro
+# prints, converts and replays game records
+TEMPLATE = app
+TARGET = replay
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
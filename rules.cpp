@@ -0,0 +1,471 @@
+// rules.cpp
+#include "rules.h"
+#include "movement.h"
+#include "zobrist.h"
+#include <cstdlib>
+#include <climits>
+
+BoardState::BoardState()
+    : BoardState(Terrain())
+{
+}
+
+BoardState::BoardState(const Terrain &map)
+{
+    for (int sq = 0; sq < BoardSquares; ++sq) {
+        terrain[sq] = map.at(sq);
+    }
+    // squares outside a smaller map are Land
+    Bitboard special;
+    for (int type = 1; type < TerrainTypeCount; ++type) {
+        terrainMask[type] = map.mask(static_cast<TerrainType>(type));
+        special |= terrainMask[type];
+    }
+    terrainMask[static_cast<int>(TerrainType::Land)] = ~special;
+}
+
+bool BoardState::hasTerrain(const Terrain &map) const
+{
+    // Land is whatever the others leave
+    for (int type = 1; type < TerrainTypeCount; ++type) {
+        if (!(terrainMask[type] == map.mask(static_cast<TerrainType>(type)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BoardState::setSquare(int sq, const PieceState &piece)
+{
+    clearSquare(sq);
+    squares[sq] = piece;
+    hash ^= pieceKey(sq, piece);
+    if (piece.type != PieceType::None) {
+        int owner = side(piece.isPlayerOne);
+        pieces[owner][static_cast<int>(piece.type)].set(sq);
+        occupancy[owner].set(sq);
+        ++pieceCount[owner];
+        kingCount[owner] += piece.type == PieceType::King;
+    }
+}
+
+void BoardState::clearSquare(int sq)
+{
+    const PieceState &old = squares[sq];
+    if (journal) {
+        journal->changes[journal->count++] = {static_cast<Square>(sq), old};
+    }
+    hash ^= pieceKey(sq, old);
+    if (old.type != PieceType::None) {
+        int owner = side(old.isPlayerOne);
+        pieces[owner][static_cast<int>(old.type)].clear(sq);
+        occupancy[owner].clear(sq);
+        --pieceCount[owner];
+        kingCount[owner] -= old.type == PieceType::King;
+    }
+    squares[sq] = PieceState();
+}
+
+GameResult BoardState::terminalResult() const
+{
+    bool playerOneLost = hasLost(0);
+    bool playerTwoLost = hasLost(1);
+    if (playerOneLost && playerTwoLost) {
+        return GameResult::Draw;
+    }
+    if (playerOneLost) {
+        return GameResult::PlayerTwoWins;
+    }
+    return playerTwoLost ? GameResult::PlayerOneWins : GameResult::Ongoing;
+}
+
+void BoardState::placePiece(int x, int y, PieceType type, bool isPlayerOne)
+{
+    PieceState piece;
+    piece.type = type;
+    piece.isPlayerOne = isPlayerOne;
+    piece.abilityUsesLeft = static_cast<std::uint8_t>(defaultAbilityUses(type));
+    setSquare(index(x, y), piece);
+}
+
+void BoardState::removePiece(int x, int y)
+{
+    clearSquare(index(x, y));
+}
+
+int defaultAbilityUses(PieceType type)
+{
+    switch (type) {
+    case PieceType::Knight: return 1;
+    case PieceType::King:   return 1;
+    case PieceType::Bishop: return 2;
+    default:                return 0; // Bomb and Queen are not limited, Pawn has none
+    }
+}
+
+const char *pieceTypeName(PieceType type)
+{
+    switch (type) {
+    case PieceType::Knight: return "Knight";
+    case PieceType::Pawn:   return "Pawn";
+    case PieceType::Bomb:   return "Bomb";
+    case PieceType::Queen:  return "Queen";
+    case PieceType::King:   return "King";
+    case PieceType::Bishop: return "Bishop";
+    default:                return "Piece";
+    }
+}
+
+void addStandardPieces(BoardState &state)
+{
+    // PlayerOne on the top row, PlayerTwo mirrored on the bottom row;
+    // wider boards centre the 11 pieces and fill the rest of the row with Pawns
+    const PieceType backRank[11] = {
+        PieceType::Pawn, PieceType::Pawn, PieceType::Knight, PieceType::Bishop,
+        PieceType::Queen, PieceType::King, PieceType::Bomb, PieceType::Bishop,
+        PieceType::Knight, PieceType::Pawn, PieceType::Pawn
+    };
+    int offset = (BoardCols - 11) / 2;
+    for (int x = 0; x < BoardCols; ++x) {
+        int column = x - offset;
+        PieceType type = column >= 0 && column < 11 ? backRank[column] : PieceType::Pawn;
+        state.placePiece(x, 0, type, true);
+        state.placePiece(x, BoardRows - 1, type, false);
+    }
+}
+
+BoardState initialBoardState()
+{
+    BoardState state(defaultTerrain);
+    addStandardPieces(state);
+    return state;
+}
+
+namespace {
+
+// squares passed on the way, the target included; moves are at most 2 long
+Bitboard pathBits(int from, int to, int dx, int dy)
+{
+    Bitboard path = Bitboard::square(to);
+    if (dx == 2 || dy == 2) {
+        path.set((from + to) / 2);
+    }
+    return path;
+}
+
+// movement pattern and terrain limits from the movement table; occupancy is checked by the caller
+RuleError checkPattern(const BoardState &state, PieceType type, int from, int to, int dx, int dy)
+{
+    const MovementRule &rule = movementRule(type, state.terrain[from]);
+    if (!rule.reaches(dx, dy)) {
+        return rule.patternError;
+    }
+    if (!rule.crossesRiver && (pathBits(from, to, dx, dy) & state.terrainBits(TerrainType::River)).any()) {
+        return rule.riverError;
+    }
+    return RuleError::None;
+}
+
+void finishTurn(BoardState &state)
+{
+    state.result = state.terminalResult();
+    state.currentPlayer = state.playerOneToMove() ? 2 : 1;
+    state.hash ^= zobristKeys.playerTwoToMove;
+    ++state.plyCount;
+}
+
+bool refuse(ActionResult *result, RuleError error)
+{
+    if (result) {
+        result->error = error;
+    }
+    return false;
+}
+
+// removes every piece of the set and books them in the result
+void takeOff(BoardState &state, Bitboard victims, ActionResult &result)
+{
+    while (victims.any()) {
+        int sq = victims.popFirst();
+        result.captured = state.squares[sq].type;
+        state.clearSquare(sq);
+        ++result.removedCount;
+    }
+}
+
+bool knightCharge(BoardState &state, int x, int y, ActionResult &result)
+{
+    int from = BoardState::index(x, y);
+    PieceState knight = state.squares[from];
+    if (knight.abilityUsesLeft == 0) {
+        result.error = RuleError::AbilityUsed;
+        return false;
+    }
+
+    // charge forward up to 5 squares, kill the first enemy or stop before a teammate
+    int owner = BoardState::side(knight.isPlayerOne);
+    Bitboard occupied = state.occupied();
+    int dy = knight.isPlayerOne ? 1 : -1;
+    int target = from;
+    for (int i = 1; i <= 5 && BoardState::inside(x, y + dy * i); ++i) {
+        int sq = BoardState::index(x, y + dy * i);
+        if (occupied.test(sq)) {
+            if (state.occupancy[1 - owner].test(sq)) {
+                takeOff(state, Bitboard::square(sq), result);
+                target = sq;
+            }
+            break;
+        }
+        target = sq;
+    }
+
+    if (target == from) {
+        result.error = RuleError::NoEffect;
+        return false;
+    }
+    knight.abilityUsesLeft--;
+    state.clearSquare(from);
+    state.setSquare(target, knight);
+    return true;
+}
+
+bool bombExplosion(BoardState &state, int x, int y, ActionResult &result)
+{
+    // kill every piece in the 3x3 area, the Bomb included
+    Bitboard area = Bitboard::square(BoardState::index(x, y)).area3x3();
+    takeOff(state, area & state.occupied(), result);
+    result.exploded = true;
+    return true;
+}
+
+bool queenStrike(BoardState &state, int x, int y, ActionResult &result)
+{
+    int from = BoardState::index(x, y);
+    int enemy = 1 - BoardState::side(state.squares[from].isPlayerOne);
+
+    // the four corners of the 5x5 square around her
+    Bitboard queen = Bitboard::square(from);
+    Bitboard columns = queen.east().east() | queen.west().west();
+    Bitboard corners = columns.north().north() | columns.south().south();
+    Bitboard victims = corners & state.occupancy[enemy];
+    if (victims.empty()) {
+        result.error = RuleError::NoEffect;
+        return false;
+    }
+    takeOff(state, victims, result);
+    return true;
+}
+
+bool kingSwap(BoardState &state, int x, int y, ActionResult &result)
+{
+    int from = BoardState::index(x, y);
+    PieceState king = state.squares[from];
+    if (king.abilityUsesLeft == 0) {
+        result.error = RuleError::AbilityUsed;
+        return false;
+    }
+
+    // seeking for the nearest friendly knight, ties go to the first square
+    Bitboard knights = state.pieces[BoardState::side(king.isPlayerOne)][static_cast<int>(PieceType::Knight)];
+    int knightSquare = -1;
+    int minDistance = INT_MAX;
+    while (knights.any()) {
+        int sq = knights.popFirst();
+        int distance = std::abs(sq % BoardCols - x) + std::abs(sq / BoardCols - y);
+        if (distance < minDistance) {
+            minDistance = distance;
+            knightSquare = sq;
+        }
+    }
+    if (knightSquare < 0) {
+        result.error = RuleError::NoKnight;
+        return false;
+    }
+
+    king.abilityUsesLeft--;
+    state.setSquare(from, state.squares[knightSquare]);
+    state.setSquare(knightSquare, king);
+    return true;
+}
+
+bool bishopSpawn(BoardState &state, int x, int y, ActionResult &result)
+{
+    int from = BoardState::index(x, y);
+    PieceState bishop = state.squares[from];
+    if (bishop.abilityUsesLeft == 0) {
+        result.error = RuleError::AbilityUsed;
+        return false;
+    }
+
+    int frontY = bishop.isPlayerOne ? y + 1 : y - 1;
+    if (!BoardState::inside(x, frontY)) {
+        result.error = RuleError::SpawnOutside;
+        return false;
+    }
+    int front = BoardState::index(x, frontY);
+    int owner = BoardState::side(bishop.isPlayerOne);
+    if (state.occupancy[owner].test(front)) {
+        result.error = RuleError::SpawnOnOwnPiece;
+        return false;
+    }
+    // kill the piece if it belongs to the opponent
+    takeOff(state, state.occupancy[1 - owner] & Bitboard::square(front), result);
+
+    bishop.abilityUsesLeft--;
+    state.setSquare(from, bishop);
+    state.placePiece(x, frontY, PieceType::Pawn, bishop.isPlayerOne);
+    return true;
+}
+
+} // namespace
+
+RuleError checkMove(const BoardState &state, int fromX, int fromY, int toX, int toY)
+{
+    if (state.result != GameResult::Ongoing) {
+        return RuleError::GameOver;
+    }
+    if (!BoardState::inside(fromX, fromY) || !BoardState::inside(toX, toY)) {
+        return RuleError::OutOfBoard;
+    }
+    int from = BoardState::index(fromX, fromY);
+    int to = BoardState::index(toX, toY);
+    int owner = BoardState::side(state.playerOneToMove());
+    if (!state.occupancy[owner].test(from)) {
+        return RuleError::NoPiece;
+    }
+    if (from == to) {
+        return RuleError::InvalidMove;
+    }
+    if (state.occupancy[owner].test(to)) {
+        return RuleError::OwnPiece;
+    }
+
+    int dx = std::abs(toX - fromX);
+    int dy = std::abs(toY - fromY);
+    RuleError error = checkPattern(state, state.squares[from].type, from, to, dx, dy);
+    if (error != RuleError::None) {
+        return error;
+    }
+
+    // cannot go over a piece on a straight or diagonal two-step
+    bool twoStep = (dx == 2 && (dy == 0 || dy == 2)) || (dx == 0 && dy == 2);
+    if (twoStep && state.occupied().test((from + to) / 2)) {
+        return RuleError::JumpOverPiece;
+    }
+
+    if (state.occupancy[1 - owner].test(to) && state.terrainBits(TerrainType::Desert).test(from)) {
+        return RuleError::DesertCapture;
+    }
+    return RuleError::None;
+}
+
+bool applyMove(BoardState &state, int fromX, int fromY, int toX, int toY, ActionResult *result)
+{
+    RuleError error = checkMove(state, fromX, fromY, toX, toY);
+    if (error != RuleError::None) {
+        return refuse(result, error);
+    }
+
+    ActionResult done;
+    int from = BoardState::index(fromX, fromY);
+    int to = BoardState::index(toX, toY);
+    PieceState mover = state.squares[from];
+    PieceType target = state.squares[to].type;
+    done.actor = mover.type;
+    done.captured = target;
+
+    state.clearSquare(from);
+    if (target == PieceType::None) {
+        state.setSquare(to, mover);
+    } else if (mover.type == PieceType::Bomb || target == PieceType::Bomb) {
+        // a Bomb on either side of the capture takes both pieces with it
+        done.exploded = true;
+        done.removedCount = 2;
+        state.clearSquare(to);
+    } else {
+        done.removedCount = 1;
+        state.setSquare(to, mover);
+    }
+
+    finishTurn(state);
+    if (result) {
+        *result = done;
+    }
+    return true;
+}
+
+bool applyAbility(BoardState &state, int x, int y, ActionResult *result)
+{
+    if (state.result != GameResult::Ongoing) {
+        return refuse(result, RuleError::GameOver);
+    }
+    if (!BoardState::inside(x, y)) {
+        return refuse(result, RuleError::OutOfBoard);
+    }
+    const PieceState &piece = state.pieceAt(x, y);
+    if (piece.type == PieceType::None || piece.isPlayerOne != state.playerOneToMove()) {
+        return refuse(result, RuleError::NoPiece);
+    }
+
+    // every ability refuses before touching the board
+    ActionResult done;
+    done.actor = piece.type;
+    bool used = false;
+    switch (piece.type) {
+    case PieceType::Knight: used = knightCharge(state, x, y, done); break;
+    case PieceType::Bomb:   used = bombExplosion(state, x, y, done); break;
+    case PieceType::Queen:  used = queenStrike(state, x, y, done); break;
+    case PieceType::King:   used = kingSwap(state, x, y, done); break;
+    case PieceType::Bishop: used = bishopSpawn(state, x, y, done); break;
+    default:                done.error = RuleError::NoAbility; break;
+    }
+    if (!used) {
+        return refuse(result, done.error);
+    }
+
+    finishTurn(state);
+    if (result) {
+        *result = done;
+    }
+    return true;
+}
+
+namespace {
+
+// runs an apply function with the journal on, then books the turn state it started from
+template <typename Apply>
+bool recordAction(BoardState &state, UndoRecord &undo, Apply apply)
+{
+    undo.count = 0;
+    undo.hash = state.hash;
+    undo.result = state.result;
+    undo.currentPlayer = static_cast<std::uint8_t>(state.currentPlayer);
+    undo.plyCount = state.plyCount;
+    state.journal = &undo;
+    bool accepted = apply();
+    state.journal = nullptr;
+    return accepted;
+}
+
+} // namespace
+
+bool makeMove(BoardState &state, int fromX, int fromY, int toX, int toY, UndoRecord &undo, ActionResult *result)
+{
+    return recordAction(state, undo, [&]() { return applyMove(state, fromX, fromY, toX, toY, result); });
+}
+
+bool makeAbility(BoardState &state, int x, int y, UndoRecord &undo, ActionResult *result)
+{
+    return recordAction(state, undo, [&]() { return applyAbility(state, x, y, result); });
+}
+
+void takeBack(BoardState &state, const UndoRecord &undo)
+{
+    for (int i = undo.count - 1; i >= 0; --i) {
+        state.setSquare(undo.changes[i].sq, undo.changes[i].before);
+    }
+    state.hash = undo.hash;
+    state.result = undo.result;
+    state.currentPlayer = undo.currentPlayer;
+    state.plyCount = undo.plyCount;
+}
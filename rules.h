@@ -0,0 +1,162 @@
+// rules.h
+#ifndef RULES_H
+#define RULES_H
+
+#include <cstdint>
+#include "board.h"
+#include "terrain.h"
+
+// headless rules core: plain values only, no Qt and no scene
+// coordinates follow the pieces: x is the column, y is the row
+
+enum class PieceType : std::uint8_t {
+    None,
+    Knight,
+    Pawn,
+    Bomb,
+    Queen,
+    King,
+    Bishop
+};
+
+// one square of the board
+struct PieceState {
+    PieceType type = PieceType::None;
+    bool isPlayerOne = false;
+    std::uint8_t abilityUsesLeft = 0; // Knight charge and King swap: 1, Bishop spawn: 2
+};
+
+enum class GameResult {
+    Ongoing,
+    PlayerOneWins,
+    PlayerTwoWins,
+    Draw
+};
+
+// why a move or an ability was refused
+enum class RuleError {
+    None,
+    MountainLimit,   // only 1 horizontally or perpendicularly in the mountains
+    ForestLimit,     // only 2 in the forest
+    BombRiver,
+    QueenRiver,
+    KingRiver,
+    BishopRiver,
+    InvalidMove,     // outside the movement pattern of the piece
+    OutOfBoard,
+    NoPiece,         // no piece of the player to move on the square
+    JumpOverPiece,
+    OwnPiece,        // target occupied by a friendly piece
+    DesertCapture,
+    NoAbility,       // Pawn
+    AbilityUsed,     // Knight charge / King swap used, Bishop out of spawns
+    NoKnight,        // King swap without a friendly Knight
+    SpawnOutside,
+    SpawnOnOwnPiece,
+    NoEffect,        // the ability would change nothing
+    GameOver
+};
+
+const int PieceTypeCount = 7; // PieceType::None included
+
+struct UndoRecord;
+
+struct BoardState {
+    TerrainType terrain[BoardSquares];
+    PieceState squares[BoardSquares];
+    int currentPlayer = 1; // 1 or 2, same as MainWindow
+    GameResult result = GameResult::Ongoing;
+    int plyCount = 0;
+    std::uint64_t hash = 0; // Zobrist key of pieces, ability uses and side to move
+
+    // bitboards kept in step with squares; player 0 is PlayerOne
+    Bitboard pieces[2][PieceTypeCount];
+    Bitboard occupancy[2];
+    Bitboard terrainMask[TerrainTypeCount]; // fixed once the map is set
+
+    // live counts per player, kept by setSquare/clearSquare for the O(1) game end check
+    std::uint8_t pieceCount[2] = {0, 0};
+    std::uint8_t kingCount[2] = {0, 0};
+
+    BoardState();
+    explicit BoardState(const Terrain &map); // empty board on the given terrain
+
+    static bool inside(int x, int y) { return x >= 0 && x < BoardCols && y >= 0 && y < BoardRows; }
+    static int index(int x, int y) { return y * BoardCols + x; }
+    static int side(bool isPlayerOne) { return isPlayerOne ? 0 : 1; }
+
+    const PieceState &pieceAt(int x, int y) const { return squares[index(x, y)]; }
+    TerrainType terrainAt(int x, int y) const { return terrain[index(x, y)]; }
+    Bitboard occupied() const { return occupancy[0] | occupancy[1]; }
+    Bitboard terrainBits(TerrainType type) const { return terrainMask[static_cast<int>(type)]; }
+    // whether the board is on map; the Zobrist key does not tell terrains apart
+    bool hasTerrain(const Terrain &map) const;
+    void placePiece(int x, int y, PieceType type, bool isPlayerOne);
+    void removePiece(int x, int y);
+    bool playerOneToMove() const { return currentPlayer == 1; }
+
+    // a side loses with its King or with its last piece, both at once is a draw;
+    // Ongoing while both have a King and a piece
+    GameResult terminalResult() const;
+    bool hasLost(int owner) const { return kingCount[owner] == 0 || pieceCount[owner] == 0; }
+
+    // square level edits that keep the bitboards and the hash in step;
+    // while journal is set every edited square is booked in it first
+    void setSquare(int sq, const PieceState &piece);
+    void clearSquare(int sq);
+    UndoRecord *journal = nullptr;
+};
+
+// what an action changed, enough to take it back: the squares as they were before
+// (captures, blast victims, spawns, swaps and ability counts alike) and the turn state
+struct UndoRecord {
+    static const int Capacity = 12; // a Bomb blast edits 9 squares, no action more
+
+    struct Change {
+        Square sq;
+        PieceState before;
+    };
+
+    Change changes[Capacity];
+    int count = 0;
+    std::uint64_t hash = 0;
+    GameResult result = GameResult::Ongoing;
+    std::uint8_t currentPlayer = 1;
+    int plyCount = 0;
+};
+
+// what an accepted action did, so a view can describe it
+struct ActionResult {
+    RuleError error = RuleError::None;
+    PieceType actor = PieceType::None;     // the moved piece or the ability user
+    PieceType captured = PieceType::None;  // victim of a move, a charge or a spawn
+    int removedCount = 0;                  // every piece taken off the board, the actor included
+    bool exploded = false;                 // a Bomb went off
+};
+
+int defaultAbilityUses(PieceType type);
+const char *pieceTypeName(PieceType type);
+
+// the opening army: one back rank per player
+void addStandardPieces(BoardState &state);
+
+// default Terrain::setupTerrain map with the standard army
+BoardState initialBoardState();
+
+// validation only, nothing is changed
+RuleError checkMove(const BoardState &state, int fromX, int fromY, int toX, int toY);
+
+// both return false and fill result->error when the action is refused;
+// an accepted action hands the turn to the other player
+bool applyMove(BoardState &state, int fromX, int fromY, int toX, int toY, ActionResult *result = nullptr);
+bool applyAbility(BoardState &state, int x, int y, ActionResult *result = nullptr);
+
+// the same, filling undo so takeBack can restore the board in place;
+// undo is only valid when they return true
+bool makeMove(BoardState &state, int fromX, int fromY, int toX, int toY, UndoRecord &undo, ActionResult *result = nullptr);
+bool makeAbility(BoardState &state, int x, int y, UndoRecord &undo, ActionResult *result = nullptr);
+
+// reverses the last made action; records are taken back newest first
+void takeBack(BoardState &state, const UndoRecord &undo);
+
+#endif // RULES_H
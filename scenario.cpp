@@ -0,0 +1,482 @@
+// scenario.cpp
+#include "scenario.h"
+#include "movegen.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHESSGAME_HAS_MMAP 1
+#endif
+
+namespace {
+
+const char ScenarioMagic[4] = {'C', 'G', 'S', '1'};
+const char TerrainChars[TerrainTypeCount] = {'.', 'F', 'M', '~', 'D'}; // by TerrainType
+const std::uint8_t PlayerOneFlag = 0x80;
+const std::uint8_t UsesMask = 0x7F;
+
+bool fail(std::string *error, const std::string &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+// padded to 4 bytes, so the header of the next record in a file stays aligned
+std::size_t recordSize(int cols, int rows, int pieceCount)
+{
+    std::size_t size = sizeof(ScenarioHeader) + std::size_t(cols) * rows + std::size_t(pieceCount) * sizeof(ScenarioPiece);
+    return (size + 3) & ~std::size_t(3);
+}
+
+// the build fixes the board size, a scenario must match it
+bool checkSize(int cols, int rows, std::string *error)
+{
+    if (cols != BoardCols || rows != BoardRows) {
+        return fail(error, "scenario is " + std::to_string(cols) + "x" + std::to_string(rows)
+                    + ", this build plays " + std::to_string(BoardCols) + "x" + std::to_string(BoardRows));
+    }
+    return true;
+}
+
+// fills state from the terrain and the piece records; both forms end here
+template <typename TerrainAt, typename PieceAt>
+bool buildState(int cols, int rows, int currentPlayer, int pieceCount,
+                TerrainAt terrainAt, PieceAt pieceAt, BoardState &state, std::string *error)
+{
+    if (!checkSize(cols, rows, error)) {
+        return false;
+    }
+    Terrain map(rows, cols);
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            TerrainType type = terrainAt(row, col);
+            if (static_cast<int>(type) >= TerrainTypeCount) {
+                return fail(error, "square " + std::to_string(col) + "," + std::to_string(row) + " has no valid terrain");
+            }
+            map.set(row, col, type);
+        }
+    }
+
+    BoardState built(map);
+    int sidePieces[2] = {0, 0};
+    for (int i = 0; i < pieceCount; ++i) {
+        const ScenarioPiece &record = pieceAt(i);
+        if (record.x >= cols || record.y >= rows) {
+            return fail(error, "piece " + std::to_string(i + 1) + " is off the board");
+        }
+        if (record.type == 0 || record.type >= PieceTypeCount) {
+            return fail(error, "piece " + std::to_string(i + 1) + " has no valid type");
+        }
+        int sq = BoardState::index(record.x, record.y);
+        if (built.squares[sq].type != PieceType::None) {
+            return fail(error, "two pieces on " + std::to_string(record.x) + "," + std::to_string(record.y));
+        }
+        if ((record.flags & UsesMask) >= ZobristKeys::AbilityStates) {
+            return fail(error, "piece " + std::to_string(i + 1) + " has more than "
+                        + std::to_string(ZobristKeys::AbilityStates - 1) + " ability uses");
+        }
+        PieceState piece;
+        piece.type = static_cast<PieceType>(record.type);
+        piece.isPlayerOne = (record.flags & PlayerOneFlag) != 0;
+        piece.abilityUsesLeft = static_cast<std::uint8_t>(record.flags & UsesMask);
+        built.setSquare(sq, piece);
+        // every spawn adds a Pawn; the action lists have room for MaxPieces a side
+        int &pieces = sidePieces[BoardState::side(piece.isPlayerOne)];
+        pieces += 1 + (piece.type == PieceType::Bishop ? piece.abilityUsesLeft : 0);
+        if (pieces > ActionList::MaxPieces) {
+            return fail(error, std::string("Player ") + (piece.isPlayerOne ? "1" : "2") + " has more than "
+                        + std::to_string(ActionList::MaxPieces) + " pieces, with the Pawns its Bishops can spawn");
+        }
+    }
+    if (currentPlayer == 2) {
+        built.currentPlayer = 2;
+        built.hash ^= zobristKeys.playerTwoToMove;
+    }
+    built.result = built.terminalResult();
+    state = built;
+    return true;
+}
+
+bool parseTerrainChar(char c, TerrainType &type)
+{
+    const char *found = static_cast<const char *>(std::memchr(TerrainChars, c, TerrainTypeCount));
+    if (!found) {
+        return false;
+    }
+    type = static_cast<TerrainType>(found - TerrainChars);
+    return true;
+}
+
+bool parsePieceType(const std::string &name, PieceType &type)
+{
+    for (int i = 1; i < PieceTypeCount; ++i) {
+        if (name == pieceTypeName(static_cast<PieceType>(i))) {
+            type = static_cast<PieceType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool ScenarioView::open(const std::uint8_t *bytes, std::size_t size, std::string *error)
+{
+    data = nullptr;
+    length = 0;
+    if (size < sizeof(ScenarioHeader)) {
+        return fail(error, "truncated scenario header");
+    }
+    const ScenarioHeader *head = reinterpret_cast<const ScenarioHeader *>(bytes);
+    if (std::memcmp(head->magic, ScenarioMagic, sizeof(ScenarioMagic)) != 0) {
+        return fail(error, "not a scenario record");
+    }
+    if (head->currentPlayer != 1 && head->currentPlayer != 2) {
+        return fail(error, "side to move is not 1 or 2");
+    }
+    std::size_t needed = recordSize(head->cols, head->rows, head->pieceCount);
+    if (size < needed) {
+        return fail(error, "truncated scenario record");
+    }
+    data = bytes;
+    length = needed;
+    return true;
+}
+
+const ScenarioPiece &ScenarioView::piece(int i) const
+{
+    const std::uint8_t *pieces = data + sizeof(ScenarioHeader) + std::size_t(cols()) * rows();
+    return reinterpret_cast<const ScenarioPiece *>(pieces)[i];
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : bytes(other.bytes), length(other.length), copy(std::move(other.copy)), mapped(other.mapped)
+{
+    if (!mapped) {
+        bytes = copy.data(); // the vector moved, its buffer did not
+    }
+    other.bytes = nullptr;
+    other.length = 0;
+    other.mapped = false;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef CHESSGAME_HAS_MMAP
+    if (mapped) {
+        munmap(const_cast<std::uint8_t *>(bytes), length);
+    }
+#endif
+}
+
+bool MappedFile::open(const std::string &path, std::string *error)
+{
+#ifdef CHESSGAME_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return fail(error, "cannot open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return fail(error, "cannot read " + path);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length == 0) {
+        ::close(fd);
+        bytes = nullptr;
+        return true;
+    }
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+    if (address == MAP_FAILED) {
+        length = 0;
+        return fail(error, "cannot map " + path);
+    }
+    bytes = static_cast<const std::uint8_t *>(address);
+    mapped = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return fail(error, "cannot open " + path);
+    }
+    copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    bytes = copy.data();
+    length = copy.size();
+    return true;
+#endif
+}
+
+bool ScenarioDirectory::open(const std::string &path, std::string *error)
+{
+    files.clear();
+    views.clear();
+    std::error_code code;
+    std::vector<std::string> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(path, code)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".cgs") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (code) {
+        return fail(error, "cannot list " + path);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    files.reserve(paths.size());
+    for (const std::string &file : paths) {
+        MappedFile mapping;
+        if (!mapping.open(file, error)) {
+            return false;
+        }
+        // a file may hold several records back to back
+        std::size_t offset = 0;
+        while (offset < mapping.size()) {
+            ScenarioView view;
+            std::string reason;
+            if (!view.open(mapping.data() + offset, mapping.size() - offset, &reason)) {
+                return fail(error, file + ": " + reason);
+            }
+            views.push_back(view);
+            offset += view.byteSize();
+        }
+        files.push_back(std::move(mapping));
+    }
+    return true;
+}
+
+bool scenarioToState(const ScenarioView &view, BoardState &state, std::string *error)
+{
+    return buildState(view.cols(), view.rows(), view.header().currentPlayer, view.pieceCount(),
+                      [&view](int row, int col) { return view.terrainAt(row, col); },
+                      [&view](int i) -> const ScenarioPiece & { return view.piece(i); },
+                      state, error);
+}
+
+bool scenarioToState(const Scenario &scenario, BoardState &state, std::string *error)
+{
+    if (scenario.terrain.size() != std::size_t(scenario.cols) * scenario.rows) {
+        return fail(error, "terrain does not cover the board");
+    }
+    return buildState(scenario.cols, scenario.rows, scenario.currentPlayer, static_cast<int>(scenario.pieces.size()),
+                      [&scenario](int row, int col) { return scenario.terrain[row * scenario.cols + col]; },
+                      [&scenario](int i) -> const ScenarioPiece & { return scenario.pieces[i]; },
+                      state, error);
+}
+
+Scenario scenarioFromState(const BoardState &state)
+{
+    Scenario scenario;
+    scenario.currentPlayer = state.currentPlayer;
+    scenario.terrain.assign(state.terrain, state.terrain + BoardSquares);
+    for (int sq = 0; sq < BoardSquares; ++sq) {
+        const PieceState &piece = state.squares[sq];
+        if (piece.type == PieceType::None) {
+            continue;
+        }
+        ScenarioPiece record;
+        record.x = static_cast<std::uint8_t>(sq % BoardCols);
+        record.y = static_cast<std::uint8_t>(sq / BoardCols);
+        record.type = static_cast<std::uint8_t>(piece.type);
+        record.flags = static_cast<std::uint8_t>((piece.isPlayerOne ? PlayerOneFlag : 0) | (piece.abilityUsesLeft & UsesMask));
+        scenario.pieces.push_back(record);
+    }
+    return scenario;
+}
+
+Scenario scenarioFromView(const ScenarioView &view)
+{
+    Scenario scenario;
+    scenario.cols = view.cols();
+    scenario.rows = view.rows();
+    scenario.currentPlayer = view.header().currentPlayer;
+    for (int row = 0; row < view.rows(); ++row) {
+        for (int col = 0; col < view.cols(); ++col) {
+            scenario.terrain.push_back(view.terrainAt(row, col));
+        }
+    }
+    for (int i = 0; i < view.pieceCount(); ++i) {
+        scenario.pieces.push_back(view.piece(i));
+    }
+    return scenario;
+}
+
+Terrain scenarioTerrain(const Scenario &scenario)
+{
+    Terrain map(scenario.rows, scenario.cols);
+    for (int row = 0; row < scenario.rows; ++row) {
+        for (int col = 0; col < scenario.cols; ++col) {
+            map.set(row, col, scenario.terrain[row * scenario.cols + col]);
+        }
+    }
+    return map;
+}
+
+std::vector<std::uint8_t> encodeScenario(const Scenario &scenario)
+{
+    ScenarioHeader head = {};
+    std::memcpy(head.magic, ScenarioMagic, sizeof(ScenarioMagic));
+    head.cols = static_cast<std::uint8_t>(scenario.cols);
+    head.rows = static_cast<std::uint8_t>(scenario.rows);
+    head.currentPlayer = static_cast<std::uint8_t>(scenario.currentPlayer);
+    head.pieceCount = static_cast<std::uint16_t>(scenario.pieces.size());
+
+    std::vector<std::uint8_t> bytes(recordSize(scenario.cols, scenario.rows, head.pieceCount));
+    std::uint8_t *out = bytes.data();
+    std::memcpy(out, &head, sizeof(head));
+    out += sizeof(head);
+    for (TerrainType type : scenario.terrain) {
+        *out++ = static_cast<std::uint8_t>(type);
+    }
+    if (!scenario.pieces.empty()) {
+        std::memcpy(out, scenario.pieces.data(), scenario.pieces.size() * sizeof(ScenarioPiece));
+    }
+    return bytes;
+}
+
+std::string scenarioToText(const Scenario &scenario)
+{
+    std::ostringstream text;
+    text << "size " << scenario.cols << ' ' << scenario.rows << '\n';
+    text << "turn " << scenario.currentPlayer << '\n';
+    text << "terrain\n";
+    for (int row = 0; row < scenario.rows; ++row) {
+        for (int col = 0; col < scenario.cols; ++col) {
+            int type = static_cast<int>(scenario.terrain[row * scenario.cols + col]);
+            text << (type < TerrainTypeCount ? TerrainChars[type] : '?'); // a file that would not load
+        }
+        text << '\n';
+    }
+    for (const ScenarioPiece &piece : scenario.pieces) {
+        PieceType type = static_cast<PieceType>(piece.type);
+        text << "piece " << ((piece.flags & PlayerOneFlag) ? 1 : 2) << ' ' << pieceTypeName(type)
+             << ' ' << int(piece.x) << ' ' << int(piece.y);
+        int uses = piece.flags & UsesMask;
+        if (uses != defaultAbilityUses(type)) {
+            text << ' ' << uses;
+        }
+        text << '\n';
+    }
+    return text.str();
+}
+
+bool parseScenarioText(const std::string &text, Scenario &scenario, std::string *error)
+{
+    Scenario parsed;
+    parsed.terrain.assign(std::size_t(parsed.cols) * parsed.rows, TerrainType::Land);
+    std::istringstream input(text);
+    std::string line;
+    int lineNumber = 0;
+    int terrainRow = -1; // >= 0 while reading the terrain grid
+    auto lineError = [&](const std::string &message) {
+        return fail(error, "line " + std::to_string(lineNumber) + ": " + message);
+    };
+
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        while (!line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r')) {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        if (terrainRow >= 0 && terrainRow < parsed.rows) {
+            if (static_cast<int>(line.size()) != parsed.cols) {
+                return lineError("terrain row needs " + std::to_string(parsed.cols) + " squares");
+            }
+            for (int col = 0; col < parsed.cols; ++col) {
+                if (!parseTerrainChar(line[col], parsed.terrain[terrainRow * parsed.cols + col])) {
+                    return lineError(std::string("unknown terrain '") + line[col] + "'");
+                }
+            }
+            ++terrainRow;
+            continue;
+        }
+
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "size") {
+            if (!(words >> parsed.cols >> parsed.rows) || parsed.cols < 1 || parsed.rows < 1
+                || parsed.cols > 255 || parsed.rows > 255) {
+                return lineError("size needs columns and rows");
+            }
+            parsed.terrain.assign(std::size_t(parsed.cols) * parsed.rows, TerrainType::Land);
+        } else if (keyword == "turn") {
+            if (!(words >> parsed.currentPlayer) || (parsed.currentPlayer != 1 && parsed.currentPlayer != 2)) {
+                return lineError("turn is 1 or 2");
+            }
+        } else if (keyword == "terrain") {
+            terrainRow = 0;
+        } else if (keyword == "piece") {
+            int player = 0;
+            std::string name;
+            int x = -1;
+            int y = -1;
+            PieceType type;
+            if (!(words >> player >> name >> x >> y) || (player != 1 && player != 2)) {
+                return lineError("piece needs a player, a type and x y");
+            }
+            if (!parsePieceType(name, type)) {
+                return lineError("unknown piece type " + name);
+            }
+            if (x < 0 || x >= parsed.cols || y < 0 || y >= parsed.rows) {
+                return lineError("piece is off the board");
+            }
+            // the uses are optional, but what stands there must be a number
+            int uses = defaultAbilityUses(type);
+            if (!(words >> std::ws).eof()) {
+                if (!(words >> uses) || !(words >> std::ws).eof()) {
+                    return lineError("ability uses must be a number");
+                }
+                if (uses < 0 || uses >= ZobristKeys::AbilityStates) {
+                    return lineError("ability uses out of range");
+                }
+            }
+            ScenarioPiece piece;
+            piece.x = static_cast<std::uint8_t>(x);
+            piece.y = static_cast<std::uint8_t>(y);
+            piece.type = static_cast<std::uint8_t>(type);
+            piece.flags = static_cast<std::uint8_t>((player == 1 ? PlayerOneFlag : 0) | uses);
+            parsed.pieces.push_back(piece);
+        } else {
+            return lineError("unknown keyword " + keyword);
+        }
+    }
+    if (terrainRow >= 0 && terrainRow < parsed.rows) {
+        return fail(error, "terrain has " + std::to_string(terrainRow) + " of " + std::to_string(parsed.rows) + " rows");
+    }
+    scenario = parsed;
+    return true;
+}
+
+bool loadScenarioFile(const std::string &path, Scenario &scenario, std::string *error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return fail(error, "cannot open " + path);
+    }
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() >= sizeof(ScenarioMagic) && std::memcmp(bytes.data(), ScenarioMagic, sizeof(ScenarioMagic)) == 0) {
+        ScenarioView view;
+        if (!view.open(reinterpret_cast<const std::uint8_t *>(bytes.data()), bytes.size(), error)) {
+            return false;
+        }
+        scenario = scenarioFromView(view);
+        return true;
+    }
+    return parseScenarioText(bytes, scenario, error);
+}
@@ -0,0 +1,119 @@
+// scenario.h
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "rules.h"
+
+// starting position: map, army, ability budgets and the side to move.
+//
+// binary form (.cgs), little endian, records may follow each other in one file:
+//   ScenarioHeader, cols * rows terrain bytes (row by row), pieceCount ScenarioPiece,
+//   zero bytes up to a multiple of 4
+//
+// text form (.txt), the readable companion:
+//   size <cols> <rows>
+//   turn <1|2>
+//   terrain                  then one line per row: . Land, F Forest, M Mountain, ~ River, D Desert
+//   piece <1|2> <type> <x> <y> [uses]   type by name, uses defaults to the type's budget
+// '#' starts a comment
+
+struct ScenarioHeader {
+    char magic[4];            // "CGS1"
+    std::uint8_t cols;
+    std::uint8_t rows;
+    std::uint8_t currentPlayer;
+    std::uint8_t reserved;
+    std::uint16_t pieceCount;
+    std::uint16_t reserved2;
+};
+
+struct ScenarioPiece {
+    std::uint8_t x;
+    std::uint8_t y;
+    std::uint8_t type;        // PieceType
+    std::uint8_t flags;       // bit 7: Player 1, bits 0-6: ability uses left, at most 2
+};
+
+static_assert(sizeof(ScenarioHeader) == 12 && sizeof(ScenarioPiece) == 4, "packed scenario records");
+
+// editable form, for the converters
+struct Scenario {
+    int cols = BoardCols;
+    int rows = BoardRows;
+    int currentPlayer = 1;
+    std::vector<TerrainType> terrain;   // rows * cols, row by row
+    std::vector<ScenarioPiece> pieces;
+};
+
+// a binary record in memory (usually a mapped file), read in place
+class ScenarioView {
+public:
+    ScenarioView() = default;
+
+    // checks the header and the sizes; size may hold more records after this one
+    bool open(const std::uint8_t *bytes, std::size_t size, std::string *error = nullptr);
+
+    const ScenarioHeader &header() const { return *reinterpret_cast<const ScenarioHeader *>(data); }
+    int cols() const { return header().cols; }
+    int rows() const { return header().rows; }
+    TerrainType terrainAt(int row, int col) const { return static_cast<TerrainType>(data[sizeof(ScenarioHeader) + row * cols() + col]); }
+    int pieceCount() const { return header().pieceCount; }
+    const ScenarioPiece &piece(int i) const;
+    std::size_t byteSize() const { return length; } // of this record
+
+private:
+    const std::uint8_t *data = nullptr;
+    std::size_t length = 0;
+};
+
+// read-only mapping of a whole file; every record in it is a ScenarioView
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    ~MappedFile();
+
+    bool open(const std::string &path, std::string *error = nullptr);
+    const std::uint8_t *data() const { return bytes; }
+    std::size_t size() const { return length; }
+
+private:
+    const std::uint8_t *bytes = nullptr;
+    std::size_t length = 0;
+    std::vector<std::uint8_t> copy; // where mmap is not available
+    bool mapped = false;
+};
+
+// every .cgs file of a directory mapped at once, records in file name order
+class ScenarioDirectory {
+public:
+    bool open(const std::string &path, std::string *error = nullptr);
+    const std::vector<ScenarioView> &scenarios() const { return views; }
+
+private:
+    std::vector<MappedFile> files;
+    std::vector<ScenarioView> views;
+};
+
+// board and view conversions; false with a message when the scenario does not fit this build
+bool scenarioToState(const ScenarioView &view, BoardState &state, std::string *error = nullptr);
+bool scenarioToState(const Scenario &scenario, BoardState &state, std::string *error = nullptr);
+Scenario scenarioFromState(const BoardState &state);
+Scenario scenarioFromView(const ScenarioView &view);
+Terrain scenarioTerrain(const Scenario &scenario);
+
+// binary records and text
+std::vector<std::uint8_t> encodeScenario(const Scenario &scenario);
+std::string scenarioToText(const Scenario &scenario);
+bool parseScenarioText(const std::string &text, Scenario &scenario, std::string *error = nullptr);
+
+// either form, told apart by the binary magic
+bool loadScenarioFile(const std::string &path, Scenario &scenario, std::string *error = nullptr);
+
+#endif // SCENARIO_H
@@ -0,0 +1,165 @@
+// main.cpp
+// scenario: text and binary scenario files
+//
+//   scenario standard OUT            the standard setup
+//   scenario convert IN OUT          text or binary IN, OUT by extension: .cgs binary, else text
+//   scenario print FILE              every record of a binary file as text
+//   scenario shuffle DIR COUNT [S]   COUNT files with shuffled back ranks, seed S
+//   scenario scan DIR                maps every .cgs file of DIR and sets up each board
+#include "scenario.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static std::uint64_t nextRandom(std::uint64_t &state)
+{
+    // splitmix64
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static bool endsWith(const std::string &text, const char *suffix)
+{
+    std::size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool writeScenario(const Scenario &scenario, const std::string &path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (endsWith(path, ".cgs")) {
+        std::vector<std::uint8_t> bytes = encodeScenario(scenario);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    } else {
+        file << scenarioToText(scenario);
+    }
+    if (!file) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static int printFile(const char *path)
+{
+    MappedFile mapping;
+    std::string error;
+    if (!mapping.open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    for (std::size_t offset = 0; offset < mapping.size();) {
+        ScenarioView view;
+        if (!view.open(mapping.data() + offset, mapping.size() - offset, &error)) {
+            std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+            return 1;
+        }
+        if (offset > 0) {
+            std::printf("\n");
+        }
+        std::printf("%s", scenarioToText(scenarioFromView(view)).c_str());
+        offset += view.byteSize();
+    }
+    return 0;
+}
+
+// the standard army with both back ranks shuffled the same way, mirrored
+static int shuffle(const std::string &directory, int count, std::uint64_t seed)
+{
+    BoardState standard = initialBoardState();
+    for (int n = 0; n < count; ++n) {
+        PieceState rank[BoardCols];
+        for (int x = 0; x < BoardCols; ++x) {
+            rank[x] = standard.pieceAt(x, 0);
+        }
+        for (int x = BoardCols - 1; x > 0; --x) {
+            std::swap(rank[x], rank[nextRandom(seed) % (x + 1)]);
+        }
+        BoardState state(defaultTerrain);
+        for (int x = 0; x < BoardCols; ++x) {
+            state.placePiece(x, 0, rank[x].type, true);
+            state.placePiece(x, BoardRows - 1, rank[x].type, false);
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "/%06d.cgs", n);
+        if (!writeScenario(scenarioFromState(state), directory + name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int scan(const char *directory)
+{
+    auto begin = std::chrono::steady_clock::now();
+    ScenarioDirectory scenarios;
+    std::string error;
+    if (!scenarios.open(directory, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double mapped = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // the hashes tie the run to the contents
+    std::uint64_t checksum = 0;
+    long long pieces = 0;
+    int failed = 0;
+    begin = std::chrono::steady_clock::now();
+    for (const ScenarioView &view : scenarios.scenarios()) {
+        BoardState state;
+        if (!scenarioToState(view, state, &error)) {
+            if (++failed <= 10) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+            }
+            continue;
+        }
+        checksum ^= state.hash;
+        pieces += state.pieceCount[0] + state.pieceCount[1];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::size_t count = scenarios.scenarios().size();
+    std::printf("scenarios %zu  failed %d  pieces %lld  checksum %016llx\n",
+                count, failed, pieces, static_cast<unsigned long long>(checksum));
+    std::printf("mapped in %.3fs, set up in %.3fs  %.0f boards/s\n",
+                mapped, seconds, seconds > 0 ? count / seconds : 0.0);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "standard" && argc == 3) {
+        return writeScenario(scenarioFromState(initialBoardState()), argv[2]) ? 0 : 1;
+    }
+    if (command == "convert" && argc == 4) {
+        Scenario scenario;
+        std::string error;
+        if (!loadScenarioFile(argv[2], scenario, &error)) {
+            std::fprintf(stderr, "%s: %s\n", argv[2], error.c_str());
+            return 1;
+        }
+        return writeScenario(scenario, argv[3]) ? 0 : 1;
+    }
+    if (command == "print" && argc == 3) {
+        return printFile(argv[2]);
+    }
+    if (command == "shuffle" && (argc == 4 || argc == 5)) {
+        return shuffle(argv[2], std::atoi(argv[3]), argc == 5 ? std::strtoull(argv[4], nullptr, 10) : 1);
+    }
+    if (command == "scan" && argc == 3) {
+        return scan(argv[2]);
+    }
+    std::fprintf(stderr, "usage: scenario standard OUT\n"
+                         "       scenario convert IN OUT\n"
+                         "       scenario print FILE\n"
+                         "       scenario shuffle DIR COUNT [SEED]\n"
+                         "       scenario scan DIR\n");
+    return 2;
+}
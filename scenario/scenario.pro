@@ -0,0 +1,10 @@
+# scenario.pro
+# converts scenarios between text and binary, writes and scans scenario directories
+TEMPLATE = app
+TARGET = scenario
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
@@ -0,0 +1,423 @@
+// search.cpp
+#include "search.h"
+#include "book.h"
+#include "eval.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const int Infinity = MateScore + 1;
+
+// history scores stay below the killers, (1 << 19); the table is halved at this
+const int HistoryLimit = 1 << 18;
+
+// captures, and abilities that take enemy pieces off the board
+bool isNoisy(const BoardState &state, const Action &action)
+{
+    if (!action.isAbility) {
+        return state.squares[action.to].type != PieceType::None;
+    }
+    PieceType type = state.squares[action.from].type;
+    return (type == PieceType::Bomb || type == PieceType::Queen) && abilityGain(state, action) > 0;
+}
+
+// captured value first, cheap attackers first; a Bomb on either side costs the attacker too
+int captureScore(const BoardState &state, const Action &action)
+{
+    PieceType attacker = state.squares[action.from].type;
+    PieceType victim = state.squares[action.to].type;
+    if (attacker == PieceType::Bomb || victim == PieceType::Bomb) {
+        return pieceValue(victim) - pieceValue(attacker);
+    }
+    return pieceValue(victim) - pieceValue(attacker) / 10;
+}
+
+// a table value as a search score, mate distances counted from the root
+int tableScore(const TableValue &value, int ply)
+{
+    switch (value.kind) {
+    case TableValue::Win:  return MateScore - (ply + value.plies);
+    case TableValue::Loss: return -(MateScore - (ply + value.plies));
+    default:               return 0;
+    }
+}
+
+} // namespace
+
+// one search thread: killers, history and the path are its own, the table is shared
+class SearchWorker {
+public:
+    SearchWorker(Search &owner, int id) : owner(owner), id(id) {}
+
+    void run(const BoardState &root, const ActionList &rootActions);
+
+    SearchResult result;
+    unsigned long long nodes = 0;
+
+private:
+    // both walk the tree in place: every action is made on state and taken back
+    int negamax(BoardState &state, int depth, int alpha, int beta, int ply);
+    int quiescence(BoardState &state, int alpha, int beta, int ply);
+    void orderActions(const BoardState &state, ActionList &list, const Action *first, int ply);
+    bool isRepetition(std::uint64_t key, int ply) const;
+    bool outOfBudget();
+
+    Search &owner;
+    int id;
+    unsigned long long pendingNodes = 0; // not yet added to the shared count
+
+    Action rootBest;          // best root action of the running iteration
+    int rootBestScore = 0;
+    bool rootHasBest = false;
+    Action rootFirst;         // best of the last iteration, searched first
+    bool hasRootFirst = false;
+    std::uint64_t pathKeys[Search::MaxPly];
+    Action killers[Search::MaxPly][2];
+    int history[BoardSquares][BoardSquares];
+};
+
+Search::Search(int threads, int hashMegabytes)
+    : table(hashMegabytes)
+{
+    setThreads(threads);
+}
+
+Search::~Search() = default;
+
+void Search::setThreads(int count)
+{
+    workers.clear();
+    for (int id = 0; id < std::max(1, count); ++id) {
+        workers.emplace_back(new SearchWorker(*this, id));
+    }
+}
+
+SearchResult Search::think(const BoardState &root, const SearchLimits &searchLimits,
+                           const std::vector<std::uint64_t> &played)
+{
+    SearchResult bookResult;
+    if (book && book->pick(root, root.hash ^ bookSeed, bookResult.best)) {
+        bookResult.found = true;
+        bookResult.fromBook = true;
+        return bookResult;
+    }
+
+    limits = searchLimits;
+    gameKeys = played;
+    table.newSearch();
+    startTime = std::chrono::steady_clock::now();
+    stopped = cancel && cancel();
+    totalNodes = 0;
+
+    ActionList rootActions;
+    generateActions(root, rootActions);
+
+    // the helpers only fill the table, the main thread decides when to stop
+    std::vector<std::thread> helpers;
+    for (std::size_t i = 1; i < workers.size(); ++i) {
+        SearchWorker *worker = workers[i].get();
+        helpers.emplace_back([worker, &root, &rootActions]() { worker->run(root, rootActions); });
+    }
+    workers[0]->run(root, rootActions);
+    stopped = true;
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    SearchResult result = workers[0]->result;
+    result.nodes = 0;
+    for (const auto &worker : workers) {
+        result.threadNodes.push_back(worker->nodes);
+        result.nodes += worker->nodes;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return result;
+}
+
+// threads add their nodes to the shared count every 1024 nodes and check the limits then
+bool Search::outOfBudget(unsigned long long &pendingNodes)
+{
+    if (++pendingNodes < 1024) {
+        return stopped.load(std::memory_order_relaxed);
+    }
+    unsigned long long total = totalNodes.fetch_add(pendingNodes, std::memory_order_relaxed) + pendingNodes;
+    pendingNodes = 0;
+    if ((limits.maxNodes && total >= limits.maxNodes) || (cancel && cancel())) {
+        stopped = true;
+    } else if (limits.timeMs) {
+        auto elapsed = std::chrono::steady_clock::now() - startTime;
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= limits.timeMs) {
+            stopped = true;
+        }
+    }
+    return stopped.load(std::memory_order_relaxed);
+}
+
+void SearchWorker::run(const BoardState &root, const ActionList &rootActions)
+{
+    BoardState board = root;
+    result = SearchResult();
+    nodes = 0;
+    pendingNodes = 0;
+    std::memset(history, 0, sizeof(history));
+    for (auto &slot : killers) {
+        slot[0] = slot[1] = Action();
+    }
+    if (rootActions.size == 0) {
+        return;
+    }
+    result.found = true;
+    result.best = rootActions[0];
+
+    // every other helper starts one ply deeper, so the threads spread over the depths
+    hasRootFirst = false;
+    for (int depth = 1 + (id & 1); depth <= owner.limits.maxDepth; ++depth) {
+        rootHasBest = false;
+        int score = negamax(board, depth, -Infinity, Infinity, 0);
+
+        // an interrupted iteration still counts once its first root action is done,
+        // the previous best is searched first
+        if (rootHasBest) {
+            result.best = rootBest;
+            result.score = rootBestScore;
+            rootFirst = rootBest;
+            hasRootFirst = true;
+        }
+        if (owner.stopped) {
+            break;
+        }
+        result.depth = depth;
+        if (id == 0 && owner.progress) {
+            SearchResult report = result;
+            report.nodes = owner.totalNodes.load(std::memory_order_relaxed) + pendingNodes;
+            report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - owner.startTime).count();
+            owner.progress(report);
+        }
+        if (score >= MateScore - MaxMateDistance || score <= -(MateScore - MaxMateDistance) || rootActions.size == 1) {
+            break; // forced result, deeper search cannot change it
+        }
+    }
+}
+
+bool SearchWorker::outOfBudget()
+{
+    ++nodes;
+    return owner.outOfBudget(pendingNodes);
+}
+
+// a position seen before with the same side to move is scored as a draw
+bool SearchWorker::isRepetition(std::uint64_t key, int ply) const
+{
+    for (int i = ply - 2; i >= 0; i -= 2) {
+        if (pathKeys[i] == key) {
+            return true;
+        }
+    }
+    // the root is pathKeys[0], the game before it alternates sides backwards from the end
+    for (int i = static_cast<int>(owner.gameKeys.size()) - 2 + (ply & 1); i >= 0; i -= 2) {
+        if (owner.gameKeys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SearchWorker::orderActions(const BoardState &state, ActionList &list, const Action *first, int ply)
+{
+    int scores[ActionList::Capacity];
+    for (int i = 0; i < list.size; ++i) {
+        const Action &action = list[i];
+        int score;
+        if (first && action == *first) {
+            score = 1 << 24;
+        } else if (!action.isAbility && state.squares[action.to].type != PieceType::None) {
+            score = (1 << 20) + captureScore(state, action);
+        } else if (action.isAbility && abilityGain(state, action) > 0) {
+            score = (1 << 20) + abilityGain(state, action);
+        } else if (action == killers[ply][0]) {
+            score = (1 << 19) + 1;
+        } else if (action == killers[ply][1]) {
+            score = 1 << 19;
+        } else {
+            score = history[action.from][action.to];
+        }
+        scores[i] = score;
+    }
+
+    // insertion sort, the lists are short
+    for (int i = 1; i < list.size; ++i) {
+        Action action = list.actions[i];
+        int score = scores[i];
+        int j = i - 1;
+        for (; j >= 0 && scores[j] < score; --j) {
+            list.actions[j + 1] = list.actions[j];
+            scores[j + 1] = scores[j];
+        }
+        list.actions[j + 1] = action;
+        scores[j + 1] = score;
+    }
+}
+
+int SearchWorker::negamax(BoardState &state, int depth, int alpha, int beta, int ply)
+{
+    if (state.result != GameResult::Ongoing) {
+        return terminalScore(state, ply);
+    }
+    if (depth <= 0 || ply >= Search::MaxPly - 1) {
+        return quiescence(state, alpha, beta, ply);
+    }
+    if (outOfBudget()) {
+        return 0;
+    }
+    pathKeys[ply] = state.hash;
+    if (ply > 0 && isRepetition(state.hash, ply)) {
+        return 0;
+    }
+    TableValue tableValue;
+    if (ply > 0 && owner.tablebases && owner.tablebases->probe(state, tableValue)) {
+        return tableScore(tableValue, ply);
+    }
+
+    // a deep enough stored result ends the node outside the principal variation
+    bool pvNode = beta - alpha > 1;
+    TTEntry entry;
+    Action tableAction;
+    bool hasTableAction = false;
+    if (owner.table.probe(state.hash, entry)) {
+        hasTableAction = TranspositionTable::unpackAction(entry.action, tableAction);
+        int stored = scoreFromTable(entry.score, ply);
+        if (!pvNode && entry.depth >= depth
+            && (entry.bound() == Bound::Exact
+                || (entry.bound() == Bound::Lower && stored >= beta)
+                || (entry.bound() == Bound::Upper && stored <= alpha))) {
+            return stored;
+        }
+    }
+
+    ActionList list;
+    generateActions(state, list);
+    if (list.size == 0) {
+        return 0; // nothing left to play: draw
+    }
+    const Action *first = hasTableAction ? &tableAction : nullptr;
+    if (ply == 0 && hasRootFirst) {
+        first = &rootFirst;
+    }
+    orderActions(state, list, first, ply);
+
+    int alphaStart = alpha;
+    int best = -Infinity;
+    Action bestAction = list[0];
+    bool firstAction = true;
+    UndoRecord undo;
+    for (const Action &action : list) {
+        makeAction(state, action, undo);
+
+        // principal variation: full window for the first action, null window for the rest
+        int score;
+        if (firstAction) {
+            score = -negamax(state, depth - 1, -beta, -alpha, ply + 1);
+        } else {
+            score = -negamax(state, depth - 1, -alpha - 1, -alpha, ply + 1);
+            if (score > alpha && score < beta && !owner.stopped) {
+                score = -negamax(state, depth - 1, -beta, -alpha, ply + 1);
+            }
+        }
+        takeBack(state, undo);
+        if (owner.stopped) {
+            return 0;
+        }
+        firstAction = false;
+
+        if (score > best) {
+            best = score;
+            bestAction = action;
+            if (ply == 0) {
+                rootBest = action;
+                rootBestScore = score;
+                rootHasBest = true;
+            }
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            if (!isNoisy(state, action)) {
+                if (killers[ply][0] != action) {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = action;
+                }
+                history[action.from][action.to] += depth * depth;
+                if (history[action.from][action.to] >= HistoryLimit) {
+                    // halving keeps the order of the quiet actions
+                    for (auto &row : history) {
+                        for (int &score : row) {
+                            score /= 2;
+                        }
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    Bound bound = best <= alphaStart ? Bound::Upper : best >= beta ? Bound::Lower : Bound::Exact;
+    owner.table.store(state.hash, scoreToTable(best, ply), depth, bound, bound == Bound::Upper ? nullptr : &bestAction);
+    return best;
+}
+
+int SearchWorker::quiescence(BoardState &state, int alpha, int beta, int ply)
+{
+    if (state.result != GameResult::Ongoing) {
+        return terminalScore(state, ply);
+    }
+    if (outOfBudget()) {
+        return 0;
+    }
+    TableValue tableValue;
+    if (owner.tablebases && owner.tablebases->probe(state, tableValue)) {
+        return tableScore(tableValue, ply);
+    }
+
+    int standPat = evaluate(state);
+    if (standPat >= beta || ply >= Search::MaxPly - 1) {
+        return standPat;
+    }
+    if (standPat > alpha) {
+        alpha = standPat;
+    }
+
+    ActionList all;
+    generateActions(state, all);
+    ActionList noisy;
+    for (const Action &action : all) {
+        if (isNoisy(state, action)) {
+            noisy.push(action.from, action.to, action.isAbility);
+        }
+    }
+    orderActions(state, noisy, nullptr, ply);
+
+    int best = standPat;
+    UndoRecord undo;
+    for (const Action &action : noisy) {
+        makeAction(state, action, undo);
+        int score = -quiescence(state, -beta, -alpha, ply + 1);
+        takeBack(state, undo);
+        if (owner.stopped) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+    return best;
+}
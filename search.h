@@ -0,0 +1,82 @@
+// search.h
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "movegen.h"
+#include "tt.h"
+
+struct SearchLimits {
+    int maxDepth = 64;
+    int timeMs = 1000;                 // 0: no time limit
+    unsigned long long maxNodes = 0;   // 0: no node limit, counted over all threads
+};
+
+struct SearchResult {
+    Action best;
+    bool found = false;       // false when the side to move has no legal action
+    int score = 0;            // from the side to move, MateScore - plies for a forced win
+    int depth = 0;            // last completed iteration of the main thread
+    unsigned long long nodes = 0;
+    std::vector<unsigned long long> threadNodes; // per thread, the main thread first
+    double seconds = 0;
+    bool fromBook = false;    // played from the opening book without a search
+};
+
+class OpeningBook;
+class SearchWorker;
+class Tablebases;
+
+// iterative-deepening alpha-beta (PVS) with quiescence on captures and explosions;
+// with more than one thread, helpers search the same root and share the
+// transposition table (Lazy SMP), the main thread's result is played
+class Search {
+public:
+    static const int MaxPly = 128;
+
+    explicit Search(int threads = 1, int hashMegabytes = 16);
+    ~Search();
+
+    void setThreads(int count);
+    int threads() const { return static_cast<int>(workers.size()); }
+
+    // played holds the keys of the positions before root, for repetitions
+    SearchResult think(const BoardState &root, const SearchLimits &limits,
+                       const std::vector<std::uint64_t> &played = std::vector<std::uint64_t>());
+    void stop() { stopped = true; } // safe to call from another thread
+    // asked by the searching threads every 1024 nodes, true stops the search as stop()
+    // does; unlike stop() it also holds for a search that is only about to start
+    void setCancel(std::function<bool()> check) { cancel = std::move(check); }
+    // called on the thread of think() after every completed iteration
+    void setProgress(std::function<void(const SearchResult &)> report) { progress = std::move(report); }
+    // book positions are answered from book, seed varies the choice between its actions
+    void setBook(const OpeningBook *openingBook, std::uint64_t seed = 0) { book = openingBook; bookSeed = seed; }
+    // positions the endgame tables hold are scored from them, exact to the ply
+    void setTablebases(const Tablebases *tables) { tablebases = tables; }
+    TranspositionTable &transpositionTable() { return table; }
+
+private:
+    friend class SearchWorker;
+
+    bool outOfBudget(unsigned long long &pendingNodes);
+
+    TranspositionTable table;
+    const OpeningBook *book = nullptr;
+    std::uint64_t bookSeed = 0;
+    const Tablebases *tablebases = nullptr;
+    std::function<bool()> cancel;
+    std::function<void(const SearchResult &)> progress;
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+    std::vector<std::uint64_t> gameKeys;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<bool> stopped{false};
+    std::atomic<unsigned long long> totalNodes{0};
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,140 @@
+// main.cpp
+// searchbench: fixed-depth search over a few positions with 1, 2, 4 ... threads
+//
+//   searchbench [depth] [--threads N] [--hash MB] [--mcts ms]
+//
+// reports nodes/second per thread and overall, and the speedup against one thread;
+// --mcts runs the Monte Carlo engine for ms per position instead and reports rollouts/second
+#include "search.h"
+#include "mcts.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// the opening and the positions after a few quick self-play actions
+static std::vector<BoardState> benchPositions()
+{
+    std::vector<BoardState> positions;
+    BoardState state = initialBoardState();
+    Search quick;
+    SearchLimits limits;
+    limits.maxDepth = 2;
+    limits.timeMs = 0;
+    for (int ply = 0; ply < 24 && state.result == GameResult::Ongoing; ++ply) {
+        if (ply % 6 == 0) {
+            positions.push_back(state);
+        }
+        SearchResult result = quick.think(state, limits);
+        if (!result.found) {
+            break;
+        }
+        applyAction(state, result.best);
+    }
+    return positions;
+}
+
+static void benchMcts(const std::vector<BoardState> &positions, const std::vector<int> &threadCounts, int timeMs)
+{
+    MctsLimits limits;
+    limits.timeMs = timeMs;
+    double singleRate = 0;
+    for (int threads : threadCounts) {
+        Mcts mcts(threads);
+        double seconds = 0;
+        unsigned long long rollouts = 0;
+        std::vector<unsigned long long> threadRollouts(threads);
+        for (const BoardState &position : positions) {
+            MctsResult result = mcts.think(position, limits);
+            seconds += result.seconds;
+            rollouts += result.rollouts;
+            for (int i = 0; i < threads && i < static_cast<int>(result.threadRollouts.size()); ++i) {
+                threadRollouts[i] += result.threadRollouts[i];
+            }
+        }
+        double rate = seconds > 0 ? rollouts / seconds : 0;
+        if (threads == 1) {
+            singleRate = rate;
+        }
+
+        std::printf("threads %2d  mcts  rollouts %llu  %.3fs  %.0f rollouts/s  speedup %.2f\n",
+                    threads, rollouts, seconds, rate, singleRate > 0 ? rate / singleRate : 0.0);
+        for (int i = 0; i < threads; ++i) {
+            std::printf("    thread %2d  rollouts %llu  %.0f rollouts/s\n",
+                        i, threadRollouts[i], seconds > 0 ? threadRollouts[i] / seconds : 0.0);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int depth = 6;
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    int hashMegabytes = 64;
+    int mctsMs = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            maxThreads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            hashMegabytes = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--mcts") == 0 && i + 1 < argc) {
+            mctsMs = std::atoi(argv[++i]);
+        } else if (std::atoi(argv[i]) > 0) {
+            depth = std::atoi(argv[i]);
+        } else {
+            std::fprintf(stderr, "usage: searchbench [depth] [--threads N] [--hash MB] [--mcts ms]\n");
+            return 2;
+        }
+    }
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::vector<BoardState> positions = benchPositions();
+
+    // powers of two, then the requested count
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    if (mctsMs > 0) {
+        benchMcts(positions, threadCounts, mctsMs);
+        return 0;
+    }
+
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    limits.timeMs = 0;
+
+    double singleSeconds = 0;
+    for (int threads : threadCounts) {
+        Search search(threads, hashMegabytes);
+        double seconds = 0;
+        unsigned long long nodes = 0;
+        std::vector<unsigned long long> threadNodes(threads);
+        for (const BoardState &position : positions) {
+            search.transpositionTable().clear();
+            SearchResult result = search.think(position, limits);
+            seconds += result.seconds;
+            nodes += result.nodes;
+            for (int i = 0; i < threads; ++i) {
+                threadNodes[i] += result.threadNodes[i];
+            }
+        }
+        if (threads == 1) {
+            singleSeconds = seconds;
+        }
+
+        std::printf("threads %2d  depth %d  nodes %llu  %.3fs  %.0f nodes/s  speedup %.2f\n",
+                    threads, depth, nodes, seconds, seconds > 0 ? nodes / seconds : 0.0,
+                    seconds > 0 ? singleSeconds / seconds : 0.0);
+        for (int i = 0; i < threads; ++i) {
+            std::printf("    thread %2d  nodes %llu  %.0f nodes/s\n",
+                        i, threadNodes[i], seconds > 0 ? threadNodes[i] / seconds : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+# searchbench.pro
+# fixed-depth search timings for growing thread counts
+TEMPLATE = app
+TARGET = searchbench
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
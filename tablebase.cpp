@@ -0,0 +1,806 @@
+// tablebase.cpp
+#include "tablebase.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const char TableMagic[4] = {'C', 'G', 'T', 'B'};
+
+// values while a table is built, above every stored one
+const std::uint16_t Unresolved = 0xFFFF;
+const std::uint16_t Impossible = 0xFFFE;
+const std::uint16_t LossFlag = 0x8000;
+
+// the remaining counter of a position: actions into the table not known to lose,
+// and a flag for a position that can no longer lose (a draw or a win outside)
+const std::uint8_t CannotLose = 0x80;
+const std::uint8_t RemainingMask = 0x7F;
+
+// the extra pieces of a table, in the order they are listed
+const PieceType ExtraTypes[] = {PieceType::Knight, PieceType::Pawn, PieceType::Bomb, PieceType::Queen,
+                                PieceType::Bishop};
+const int MaterialKeys = 59049; // 3^10: 0 to 2 of every extra type per side
+
+bool fail(std::string *error, const std::string &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+char pieceLetter(PieceType type)
+{
+    switch (type) {
+    case PieceType::King:   return 'K';
+    case PieceType::Knight: return 'N';
+    case PieceType::Pawn:   return 'P';
+    case PieceType::Bomb:   return 'X';
+    case PieceType::Queen:  return 'Q';
+    case PieceType::Bishop: return 'B';
+    default:                return '?';
+    }
+}
+
+int extraIndex(PieceType type)
+{
+    for (int i = 0; i < 5; ++i) {
+        if (ExtraTypes[i] == type) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int materialKey(const int counts[2][5])
+{
+    int key = 0;
+    for (int side = 0; side < 2; ++side) {
+        for (int i = 0; i < 5; ++i) {
+            key = key * 3 + counts[side][i];
+        }
+    }
+    return key;
+}
+
+TableValue decodeValue(std::uint16_t raw)
+{
+    TableValue value;
+    if (raw & LossFlag) {
+        value.kind = TableValue::Loss;
+        value.plies = raw & ~LossFlag;
+    } else if (raw != 0) {
+        value.kind = TableValue::Win;
+        value.plies = raw;
+    }
+    return value;
+}
+
+void clearBoard(BoardState &state)
+{
+    Bitboard occupied = state.occupied();
+    while (occupied.any()) {
+        state.clearSquare(occupied.popFirst());
+    }
+}
+
+void flipSide(BoardState &state)
+{
+    state.currentPlayer = state.playerOneToMove() ? 2 : 1;
+    state.hash ^= zobristKeys.playerTwoToMove;
+}
+
+// runs [first, last) of the work on threads, each with its own id
+template <typename Work>
+void parallelFor(std::uint64_t count, int threads, Work work)
+{
+    const std::uint64_t chunk = 4096;
+    std::atomic<std::uint64_t> next{0};
+    auto run = [&](int id) {
+        for (std::uint64_t first = next.fetch_add(chunk); first < count; first = next.fetch_add(chunk)) {
+            work(id, first, std::min(count, first + chunk));
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (int id = 1; id < threads; ++id) {
+        helpers.emplace_back(run, id);
+    }
+    run(0);
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+}
+
+} // namespace
+
+TableMaterial::TableMaterial(const std::vector<PieceType> &playerOne, const std::vector<PieceType> &playerTwo)
+{
+    const std::vector<PieceType> *sides[2] = {&playerOne, &playerTwo};
+    for (int side = 0; side < 2; ++side) {
+        types[count++] = PieceType::King;
+        std::vector<PieceType> extra;
+        for (PieceType type : *sides[side]) {
+            if (type != PieceType::King) {
+                extra.push_back(type);
+            }
+        }
+        std::sort(extra.begin(), extra.end(), [](PieceType a, PieceType b) { return extraIndex(a) < extraIndex(b); });
+        for (PieceType type : extra) {
+            if (count < MaxPieces) {
+                types[count++] = type;
+            }
+        }
+        sideCount[side] = side == 0 ? count : count - sideCount[0];
+    }
+    finish();
+}
+
+void TableMaterial::finish()
+{
+    // a Knight's charge and, next to a friendly Knight, the King's swap
+    usesBits = 0;
+    for (int slot = 0; slot < count; ++slot) {
+        bool knight = false;
+        int first = isPlayerOne(slot) ? 0 : sideCount[0];
+        for (int other = first; other < first + sideCount[isPlayerOne(slot) ? 0 : 1]; ++other) {
+            knight = knight || types[other] == PieceType::Knight;
+        }
+        hasUsesBit[slot] = types[slot] == PieceType::Knight || (types[slot] == PieceType::King && knight);
+        usesBits += hasUsesBit[slot];
+    }
+    // the extra pieces of a side are sorted, twins are next to each other
+    pairSlot = -1;
+    for (int slot = 1; slot < count; ++slot) {
+        if (types[slot] == types[slot - 1] && isPlayerOne(slot) == isPlayerOne(slot - 1)) {
+            pairSlot = slot;
+        }
+    }
+}
+
+bool TableMaterial::parse(const std::string &name, TableMaterial &material)
+{
+    std::size_t split = name.find('v');
+    if (split == std::string::npos || split == 0 || split + 1 >= name.size()) {
+        return false;
+    }
+    std::vector<PieceType> sides[2];
+    for (int side = 0; side < 2; ++side) {
+        std::string letters = side == 0 ? name.substr(0, split) : name.substr(split + 1);
+        if (letters[0] != 'K') {
+            return false;
+        }
+        for (std::size_t i = 1; i < letters.size(); ++i) {
+            PieceType type = PieceType::None;
+            for (PieceType extra : ExtraTypes) {
+                if (pieceLetter(extra) == letters[i]) {
+                    type = extra;
+                }
+            }
+            if (type == PieceType::None) {
+                return false;
+            }
+            sides[side].push_back(type);
+        }
+    }
+    if (sides[0].size() + sides[1].size() + 2 > MaxPieces) {
+        return false;
+    }
+    material = TableMaterial(sides[0], sides[1]);
+    return true;
+}
+
+bool TableMaterial::of(const BoardState &state, TableMaterial &material)
+{
+    if (state.kingCount[0] != 1 || state.kingCount[1] != 1 || state.pieceCount[0] + state.pieceCount[1] > MaxPieces) {
+        return false;
+    }
+    std::vector<PieceType> sides[2];
+    for (int side = 0; side < 2; ++side) {
+        for (PieceType type : ExtraTypes) {
+            for (int n = state.pieces[side][static_cast<int>(type)].count(); n > 0; --n) {
+                sides[side].push_back(type);
+            }
+        }
+    }
+    material = TableMaterial(sides[0], sides[1]);
+    return true;
+}
+
+std::string TableMaterial::name() const
+{
+    std::string text;
+    for (int slot = 0; slot < count; ++slot) {
+        if (slot == sideCount[0]) {
+            text += 'v';
+        }
+        text += pieceLetter(types[slot]);
+    }
+    return text;
+}
+
+std::uint64_t TableMaterial::positionCount() const
+{
+    std::uint64_t positions = 2;
+    for (int slot = 0; slot < count; ++slot) {
+        if (slot == pairSlot) {
+            positions = positions / BoardSquares * PairCount;
+        } else {
+            positions *= BoardSquares;
+        }
+    }
+    return positions << usesBits;
+}
+
+int TableMaterial::key() const
+{
+    int counts[2][5] = {};
+    for (int slot = 0; slot < count; ++slot) {
+        int extra = extraIndex(types[slot]);
+        if (extra >= 0) {
+            ++counts[isPlayerOne(slot) ? 0 : 1][extra];
+        }
+    }
+    return materialKey(counts);
+}
+
+bool TableMaterial::index(const BoardState &state, std::uint64_t &index) const
+{
+    std::uint64_t squares = state.playerOneToMove() ? 0 : 1;
+    std::uint64_t uses = 0;
+    Bitboard taken[2][PieceTypeCount];
+    for (int slot = 0; slot < count; ++slot) {
+        int side = isPlayerOne(slot) ? 0 : 1;
+        int type = static_cast<int>(types[slot]);
+        Bitboard left = state.pieces[side][type] & ~taken[side][type];
+        if (left.empty()) {
+            return false;
+        }
+        int sq = left.first();
+        taken[side][type].set(sq);
+        const PieceState &piece = state.squares[sq];
+        if (types[slot] == PieceType::Bishop && piece.abilityUsesLeft > 0) {
+            return false; // could still spawn into a bigger material
+        }
+        if (hasUsesBit[slot] && piece.abilityUsesLeft > 1) {
+            return false; // a scenario's second charge or swap, the bit holds one
+        }
+        if (slot == pairSlot) {
+            // the first twin took the lower square, it comes out of squares again
+            int low = static_cast<int>(squares % BoardSquares);
+            squares = squares / BoardSquares * PairCount + static_cast<std::uint64_t>(sq * (sq - 1) / 2 + low);
+        } else {
+            squares = squares * BoardSquares + static_cast<std::uint64_t>(sq);
+        }
+        if (hasUsesBit[slot]) {
+            uses = uses * 2 + (piece.abilityUsesLeft > 0 ? 1 : 0);
+        }
+    }
+    index = (squares << usesBits) | uses;
+    return true;
+}
+
+bool TableMaterial::place(std::uint64_t index, BoardState &state) const
+{
+    int squares[MaxPieces];
+    int uses[MaxPieces] = {};
+    std::uint64_t rest = index >> usesBits;
+    std::uint64_t usesPart = index & ((std::uint64_t(1) << usesBits) - 1);
+    for (int slot = count - 1; slot >= 0; --slot) {
+        if (slot == pairSlot) {
+            // the pair number high * (high - 1) / 2 + low, with low < high
+            int pair = static_cast<int>(rest % PairCount);
+            rest /= PairCount;
+            int high = static_cast<int>((1 + std::sqrt(1.0 + 8.0 * pair)) / 2);
+            while (high * (high - 1) / 2 > pair) {
+                --high;
+            }
+            while ((high + 1) * high / 2 <= pair) {
+                ++high;
+            }
+            squares[slot] = high;
+            squares[slot - 1] = pair - high * (high - 1) / 2;
+        } else if (slot + 1 != pairSlot) {
+            squares[slot] = static_cast<int>(rest % BoardSquares);
+            rest /= BoardSquares;
+        }
+        if (hasUsesBit[slot]) {
+            uses[slot] = static_cast<int>(usesPart & 1);
+            usesPart >>= 1;
+        }
+    }
+    for (int slot = 0; slot < count; ++slot) {
+        for (int other = 0; other < slot; ++other) {
+            if (squares[other] == squares[slot]) {
+                return false;
+            }
+        }
+    }
+    for (int slot = 0; slot < count; ++slot) {
+        PieceState piece;
+        piece.type = types[slot];
+        piece.isPlayerOne = isPlayerOne(slot);
+        piece.abilityUsesLeft = static_cast<std::uint8_t>(uses[slot]);
+        state.setSquare(squares[slot], piece);
+    }
+    if ((rest == 0) != state.playerOneToMove()) {
+        flipSide(state);
+    }
+    state.result = GameResult::Ongoing;
+    return true;
+}
+
+std::vector<TableMaterial> tableMaterials(int pieces)
+{
+    // multisets of extra pieces in list order, of every size up to 2
+    std::vector<std::vector<PieceType>> sets[3] = {{{}}, {}, {}};
+    for (int size = 1; size < 3; ++size) {
+        for (const auto &set : sets[size - 1]) {
+            for (int i = set.empty() ? 0 : extraIndex(set.back()); i < 5; ++i) {
+                sets[size].push_back(set);
+                sets[size].back().push_back(ExtraTypes[i]);
+            }
+        }
+    }
+    std::vector<TableMaterial> materials;
+    for (int extra = 0; extra + 2 <= std::min(pieces, static_cast<int>(TableMaterial::MaxPieces)); ++extra) {
+        for (int one = extra; one >= 0; --one) {
+            for (const auto &playerOne : sets[one]) {
+                for (const auto &playerTwo : sets[extra - one]) {
+                    materials.push_back(TableMaterial(playerOne, playerTwo));
+                }
+            }
+        }
+    }
+    return materials;
+}
+
+struct Tablebases::Table {
+    MappedFile file;
+    TableMaterial material;
+    const TableHeader *header = nullptr;
+    const std::uint64_t *offsets = nullptr;
+    const std::uint8_t *blocks = nullptr;
+
+    std::uint16_t value(std::uint64_t index) const {
+        const std::uint8_t *block = blocks + offsets[index / TableMaterial::BlockSize];
+        int bits = block[1];
+        const std::uint8_t *palette = block + 2;
+        unsigned slot = 0;
+        if (bits > 0) {
+            // the index may straddle two bytes
+            std::size_t bit = (index % TableMaterial::BlockSize) * static_cast<unsigned>(bits);
+            const std::uint8_t *packed = palette + 2 * (block[0] + 1) + bit / 8;
+            unsigned word = packed[0] | (bit % 8 + bits > 8 ? packed[1] << 8 : 0);
+            slot = (word >> (bit % 8)) & ((1u << bits) - 1);
+        }
+        return static_cast<std::uint16_t>(palette[2 * slot] | (palette[2 * slot + 1] << 8));
+    }
+};
+
+Tablebases::Tablebases()
+    : byKey(MaterialKeys, nullptr)
+{
+}
+
+Tablebases::~Tablebases() = default;
+
+bool Tablebases::open(const std::string &directory, std::string *error)
+{
+    std::error_code code;
+    std::vector<std::string> paths;
+    for (const auto &item : std::filesystem::directory_iterator(directory, code)) {
+        if (item.is_regular_file() && item.path().extension() == ".cgt") {
+            paths.push_back(item.path().string());
+        }
+    }
+    if (code) {
+        return fail(error, "cannot list " + directory);
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const std::string &path : paths) {
+        if (!add(path, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Tablebases::add(const std::string &path, std::string *error)
+{
+    std::unique_ptr<Table> table(new Table);
+    if (!table->file.open(path, error)) {
+        return false;
+    }
+    const std::uint8_t *data = table->file.data();
+    std::size_t size = table->file.size();
+    if (size < sizeof(TableHeader) || std::memcmp(data, TableMagic, sizeof(TableMagic)) != 0) {
+        return fail(error, path + " is not an endgame table");
+    }
+    const TableHeader *header = reinterpret_cast<const TableHeader *>(data);
+    if (header->cols != BoardCols || header->rows != BoardRows) {
+        return fail(error, path + " is for another board size");
+    }
+    std::vector<PieceType> sides[2];
+    for (int side = 0; side < 2; ++side) {
+        for (int i = 1; i < 4 && header->pieces[side][i] != 0; ++i) {
+            sides[side].push_back(static_cast<PieceType>(header->pieces[side][i]));
+        }
+    }
+    table->material = TableMaterial(sides[0], sides[1]);
+    std::size_t blocksAt = sizeof(TableHeader) + (std::size_t(header->blockCount) + 1) * sizeof(std::uint64_t);
+    std::uint64_t blocks = (header->positionCount + TableMaterial::BlockSize - 1) / TableMaterial::BlockSize;
+    if (header->positionCount != table->material.positionCount() || header->blockCount != blocks || size < blocksAt) {
+        return fail(error, path + " does not match its material");
+    }
+    table->offsets = reinterpret_cast<const std::uint64_t *>(data + sizeof(TableHeader));
+    if (size < blocksAt + table->offsets[header->blockCount]) {
+        return fail(error, path + " is truncated");
+    }
+    table->blocks = data + blocksAt;
+    table->header = header;
+
+    const Table *added = table.get();
+    byKey[static_cast<std::size_t>(added->material.key())] = added;
+    largest = std::max(largest, added->material.pieceCount());
+    tables.push_back(std::move(table));
+    return true;
+}
+
+bool Tablebases::probe(const BoardState &state, TableValue &value) const
+{
+    if (state.result != GameResult::Ongoing || state.pieceCount[0] + state.pieceCount[1] > largest
+        || state.kingCount[0] != 1 || state.kingCount[1] != 1) {
+        return false;
+    }
+    // the tables are for the standard terrain only
+    if (!state.hasTerrain(defaultTerrain)) {
+        return false;
+    }
+    int counts[2][5] = {};
+    for (int side = 0; side < 2; ++side) {
+        for (int i = 0; i < 5; ++i) {
+            int n = state.pieces[side][static_cast<int>(ExtraTypes[i])].count();
+            if (n > 2) {
+                return false;
+            }
+            counts[side][i] = n;
+        }
+    }
+    const Table *table = byKey[static_cast<std::size_t>(materialKey(counts))];
+    std::uint64_t index;
+    if (!table || !table->material.index(state, index)) {
+        return false;
+    }
+    value = decodeValue(table->value(index));
+    return true;
+}
+
+bool buildTable(const TableMaterial &material, const Tablebases &known, const std::string &output, int threads,
+                TableBuildStats *stats, std::string *error)
+{
+    const std::uint64_t positions = material.positionCount();
+    if (positions > MaxBuildPositions) {
+        return fail(error, material.name() + " is too big");
+    }
+    threads = std::max(1, threads);
+    std::unique_ptr<std::atomic<std::uint16_t>[]> values(new std::atomic<std::uint16_t>[positions]);
+    std::unique_ptr<std::atomic<std::uint8_t>[]> remaining(new std::atomic<std::uint8_t>[positions]);
+    std::unique_ptr<std::atomic<std::uint16_t>[]> longestLoss(new std::atomic<std::uint16_t>[positions]);
+
+    // positions to settle at every distance, as wins and as losses, filled per thread
+    struct Buckets {
+        std::vector<std::vector<std::uint32_t>> wins;
+        std::vector<std::vector<std::uint32_t>> losses;
+        void add(std::vector<std::vector<std::uint32_t>> &list, int plies, std::uint64_t index) {
+            if (static_cast<int>(list.size()) <= plies) {
+                list.resize(plies + 1);
+            }
+            list[plies].push_back(static_cast<std::uint32_t>(index));
+        }
+    };
+    std::vector<Buckets> threadBuckets(threads);
+    std::atomic<bool> missing{false};
+    std::string missingName;
+    std::mutex missingLock;
+
+    // every position once forward: its actions into the table, and what the
+    // actions out of it (captures, explosions, game ends) are worth
+    parallelFor(positions, threads, [&](int id, std::uint64_t first, std::uint64_t last) {
+        BoardState board(defaultTerrain);
+        ActionList list;
+        UndoRecord undo;
+        Buckets &buckets = threadBuckets[id];
+        for (std::uint64_t index = first; index < last; ++index) {
+            longestLoss[index] = 0;
+            if (!material.place(index, board)) {
+                values[index] = Impossible;
+                remaining[index] = 0;
+                clearBoard(board);
+                continue;
+            }
+            values[index] = Unresolved;
+            generateActions(board, list);
+            int inside = 0;
+            bool cannotLose = list.size == 0; // nothing to play is a draw
+            int bestWin = 0;
+            int longest = 0;
+            bool mover = board.playerOneToMove();
+            for (const Action &action : list) {
+                makeAction(board, action, undo);
+                if (board.result != GameResult::Ongoing) {
+                    if (board.result == GameResult::Draw) {
+                        cannotLose = true;
+                    } else if ((board.result == GameResult::PlayerOneWins) == mover) {
+                        bestWin = 1;
+                    }
+                    // a blast that takes the mover's own King: a loss in 0 behind it
+                } else if (board.pieceCount[0] + board.pieceCount[1] == material.pieceCount()) {
+                    ++inside; // only captures and explosions change the material
+                } else {
+                    TableValue next;
+                    TableMaterial child;
+                    if (!known.probe(board, next)) {
+                        if (!missing.exchange(true) && TableMaterial::of(board, child)) {
+                            std::lock_guard<std::mutex> guard(missingLock);
+                            missingName = child.name();
+                        }
+                    } else if (next.kind == TableValue::Loss) {
+                        bestWin = bestWin == 0 ? next.plies + 1 : std::min(bestWin, next.plies + 1);
+                    } else if (next.kind == TableValue::Win) {
+                        longest = std::max(longest, next.plies);
+                    } else {
+                        cannotLose = true;
+                    }
+                }
+                takeBack(board, undo);
+            }
+            longestLoss[index] = static_cast<std::uint16_t>(longest);
+            remaining[index] = static_cast<std::uint8_t>(std::min(inside, 127)
+                                                         | (cannotLose || bestWin > 0 ? CannotLose : 0));
+            if (bestWin > 0) {
+                buckets.add(buckets.wins, bestWin, index);
+            } else if (inside == 0 && !cannotLose) {
+                buckets.add(buckets.losses, longest + 1, index);
+            }
+            clearBoard(board);
+        }
+    });
+    if (missing) {
+        return fail(error, "the " + missingName + " table is needed first");
+    }
+
+    // distance by distance: a position that loses makes its predecessors wins one
+    // ply further, one that wins takes an action away from them; a predecessor
+    // without actions left loses after the longest of them
+    std::vector<std::vector<std::uint32_t>> frontiers(threads);
+    for (int plies = 1;; ++plies) {
+        bool more = false;
+        for (int id = 0; id < threads; ++id) {
+            frontiers[id].clear();
+        }
+        // the buckets of this distance are final, the first claim on a position wins
+        for (int id = 0; id < threads; ++id) {
+            Buckets &buckets = threadBuckets[id];
+            for (int kind = 0; kind < 2; ++kind) {
+                auto &list = kind == 0 ? buckets.wins : buckets.losses;
+                if (static_cast<int>(list.size()) <= plies) {
+                    continue;
+                }
+                std::uint16_t settled = static_cast<std::uint16_t>(kind == 0 ? plies : (plies | LossFlag));
+                for (std::uint32_t index : list[plies]) {
+                    std::uint16_t expected = Unresolved;
+                    if (values[index].compare_exchange_strong(expected, settled)) {
+                        frontiers[id].push_back(index);
+                    }
+                }
+                std::vector<std::uint32_t>().swap(list[plies]);
+            }
+        }
+        std::vector<std::uint32_t> frontier;
+        for (auto &part : frontiers) {
+            frontier.insert(frontier.end(), part.begin(), part.end());
+        }
+        for (const Buckets &buckets : threadBuckets) {
+            more = more || static_cast<int>(buckets.wins.size()) > plies + 1
+                || static_cast<int>(buckets.losses.size()) > plies + 1;
+        }
+        if (frontier.empty() && !more) {
+            break;
+        }
+        if (plies >= 0x7FF0) {
+            return fail(error, material.name() + " has a game too long to store");
+        }
+
+        parallelFor(frontier.size(), threads, [&](int id, std::uint64_t first, std::uint64_t last) {
+            BoardState board(defaultTerrain);
+            UndoRecord undo;
+            Buckets &buckets = threadBuckets[id];
+            for (std::uint64_t at = first; at < last; ++at) {
+                std::uint64_t settled = frontier[at];
+                material.place(settled, board);
+                bool settledLoses = (values[settled].load() & LossFlag) != 0;
+                const std::uint64_t settledHash = board.hash;
+
+                // every way the other side could have got here inside the table
+                auto predecessor = [&](const Action &action) {
+                    std::uint64_t index;
+                    if (!material.index(board, index) || values[index].load() != Unresolved
+                        || !makeAction(board, action, undo)) {
+                        return;
+                    }
+                    bool reaches = board.hash == settledHash;
+                    takeBack(board, undo);
+                    if (!reaches) {
+                        return;
+                    }
+                    if (settledLoses) {
+                        buckets.add(buckets.wins, plies + 1, index);
+                        return;
+                    }
+                    std::uint16_t longest = longestLoss[index].load();
+                    while (longest < plies && !longestLoss[index].compare_exchange_weak(longest, plies)) {
+                    }
+                    std::uint8_t before = remaining[index].fetch_sub(1);
+                    if ((before & RemainingMask) == 1 && !(before & CannotLose)) {
+                        buckets.add(buckets.losses, std::max<int>(plies, longestLoss[index].load()) + 1, index);
+                    }
+                };
+
+                flipSide(board);
+                int mover = board.playerOneToMove() ? 0 : 1;
+                Bitboard own = board.occupancy[mover];
+                while (own.any()) {
+                    int to = own.popFirst();
+                    PieceState piece = board.squares[to];
+                    int x = to % BoardCols;
+                    int y = to / BoardCols;
+                    // a move back from the 5x5 square around it
+                    for (int dy = -2; dy <= 2; ++dy) {
+                        for (int dx = -2; dx <= 2; ++dx) {
+                            int fromX = x + dx;
+                            int fromY = y + dy;
+                            if ((dx == 0 && dy == 0) || !BoardState::inside(fromX, fromY)
+                                || board.squares[BoardState::index(fromX, fromY)].type != PieceType::None) {
+                                continue;
+                            }
+                            int from = BoardState::index(fromX, fromY);
+                            board.clearSquare(to);
+                            board.setSquare(from, piece);
+                            predecessor(Action::move(from, to));
+                            board.clearSquare(from);
+                            board.setSquare(to, piece);
+                        }
+                    }
+                    // a charge from up to 5 squares behind, the charge still unused before it
+                    if (piece.type == PieceType::Knight && piece.abilityUsesLeft == 0) {
+                        PieceState before = piece;
+                        before.abilityUsesLeft = 1;
+                        int back = piece.isPlayerOne ? -1 : 1;
+                        for (int i = 1; i <= 5 && BoardState::inside(x, y + back * i); ++i) {
+                            int from = BoardState::index(x, y + back * i);
+                            if (board.squares[from].type != PieceType::None) {
+                                break;
+                            }
+                            board.clearSquare(to);
+                            board.setSquare(from, before);
+                            predecessor(Action::ability(from));
+                            board.clearSquare(from);
+                            board.setSquare(to, piece);
+                        }
+                    }
+                    // a King swap with any of its Knights
+                    if (piece.type == PieceType::King && piece.abilityUsesLeft == 0) {
+                        PieceState before = piece;
+                        before.abilityUsesLeft = 1;
+                        Bitboard knights = board.pieces[mover][static_cast<int>(PieceType::Knight)];
+                        while (knights.any()) {
+                            int knightSquare = knights.popFirst();
+                            PieceState knight = board.squares[knightSquare];
+                            board.setSquare(to, knight);
+                            board.setSquare(knightSquare, before);
+                            predecessor(Action::ability(knightSquare));
+                            board.setSquare(knightSquare, knight);
+                            board.setSquare(to, piece);
+                        }
+                    }
+                }
+                flipSide(board);
+                clearBoard(board);
+            }
+        });
+    }
+
+    // what is left cannot be forced either way; impossible positions are left out
+    // of the palettes, any index will do for them
+    TableBuildStats counted;
+    counted.positions = positions;
+    std::vector<std::uint64_t> offsets;
+    std::vector<std::uint8_t> blocks;
+    for (std::uint64_t first = 0; first < positions; first += TableMaterial::BlockSize) {
+        offsets.push_back(blocks.size());
+        std::uint64_t last = std::min(positions, first + TableMaterial::BlockSize);
+        std::vector<std::uint16_t> palette;
+        std::uint8_t slots[TableMaterial::BlockSize] = {};
+        for (std::uint64_t index = first; index < last; ++index) {
+            std::uint16_t value = values[index].load();
+            if (value == Impossible) {
+                continue;
+            }
+            if (value == Unresolved) {
+                value = 0;
+            }
+            TableValue decoded = decodeValue(value);
+            counted.wins += decoded.kind == TableValue::Win;
+            counted.losses += decoded.kind == TableValue::Loss;
+            counted.draws += decoded.kind == TableValue::Draw;
+            if (decoded.kind == TableValue::Win) {
+                counted.longest = std::max(counted.longest, decoded.plies);
+            }
+            auto known = std::find(palette.begin(), palette.end(), value);
+            slots[index - first] = static_cast<std::uint8_t>(known - palette.begin());
+            if (known == palette.end()) {
+                palette.push_back(value);
+            }
+        }
+        if (palette.empty()) {
+            palette.push_back(0);
+        }
+        int bits = 0;
+        while ((std::size_t(1) << bits) < palette.size()) {
+            ++bits;
+        }
+        blocks.push_back(static_cast<std::uint8_t>(palette.size() - 1));
+        blocks.push_back(static_cast<std::uint8_t>(bits));
+        for (std::uint16_t value : palette) {
+            blocks.push_back(static_cast<std::uint8_t>(value & 0xFF));
+            blocks.push_back(static_cast<std::uint8_t>(value >> 8));
+        }
+        std::size_t packedAt = blocks.size();
+        blocks.resize(packedAt + (TableMaterial::BlockSize * bits + 7) / 8 + 1, 0);
+        for (int i = 0; i < TableMaterial::BlockSize; ++i) {
+            std::size_t bit = static_cast<std::size_t>(i) * bits;
+            unsigned word = static_cast<unsigned>(slots[i]) << (bit % 8);
+            blocks[packedAt + bit / 8] |= static_cast<std::uint8_t>(word & 0xFF);
+            blocks[packedAt + bit / 8 + 1] |= static_cast<std::uint8_t>(word >> 8);
+        }
+    }
+    offsets.push_back(blocks.size());
+
+    TableHeader header = {};
+    std::memcpy(header.magic, TableMagic, sizeof(TableMagic));
+    header.cols = BoardCols;
+    header.rows = BoardRows;
+    int filled[2] = {0, 0};
+    for (int slot = 0; slot < material.pieceCount(); ++slot) {
+        int side = material.isPlayerOne(slot) ? 0 : 1;
+        header.pieces[side][filled[side]++] = static_cast<std::uint8_t>(material.type(slot));
+    }
+    header.positionCount = positions;
+    header.blockCount = static_cast<std::uint32_t>(offsets.size() - 1);
+
+    std::FILE *out = std::fopen(output.c_str(), "wb");
+    if (!out) {
+        return fail(error, "cannot write " + output);
+    }
+    std::fwrite(&header, sizeof(header), 1, out);
+    std::fwrite(offsets.data(), sizeof(std::uint64_t), offsets.size(), out);
+    std::fwrite(blocks.data(), 1, blocks.size(), out);
+    bool written = std::ferror(out) == 0;
+    written = std::fclose(out) == 0 && written;
+    if (!written) {
+        return fail(error, "cannot write " + output);
+    }
+    counted.bytes = sizeof(header) + offsets.size() * sizeof(std::uint64_t) + blocks.size();
+    if (stats) {
+        *stats = counted;
+    }
+    return true;
+}
@@ -0,0 +1,129 @@
+// tablebase.h
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "movegen.h"
+#include "scenario.h"
+
+// endgame tables for every position of a small material on the standard terrain:
+// both Kings plus up to two more pieces, the exact result with the plies to the end.
+// A table is named after its material, Player 1 first: KQvK, KNvKP, KXPvK ...
+// with K King, N Knight, P Pawn, X Bomb, Q Queen, B Bishop.
+//
+// Knight charges and King swaps left are part of the position; Bishops are only in
+// the tables with their spawns used up, a Bishop that can still spawn is not covered.
+//
+// File (.cgt), read through mmap: a TableHeader, blockCount + 1 byte offsets of the
+// blocks, then the blocks of BlockSize positions each: n - 1 for its n distinct values,
+// the bits per position b, the n 16-bit values and a b-bit index into them per position
+//   0                draw
+//   1 .. 0x7FFF      the side to move wins in that many plies
+//   0x8000 | plies   the side to move loses in that many plies
+
+struct TableHeader {
+    char magic[4];              // "CGTB"
+    std::uint16_t cols;
+    std::uint16_t rows;
+    std::uint8_t pieces[2][4];  // PieceType of each side, King first, None after the last
+    std::uint64_t positionCount;
+    std::uint32_t blockCount;
+    std::uint32_t reserved;
+};
+
+struct TableValue {
+    enum Kind { Draw, Win, Loss } kind = Draw; // for the side to move
+    int plies = 0;                              // to the end of the game with best play
+};
+
+// pieces of each side and how a position is numbered: the side to move, then the
+// square of every piece, then a bit for every Knight charge and King swap left.
+// Two pieces of one type and side share one number for the pair of their squares,
+// the lower square first, so that a position has a single index
+class TableMaterial {
+public:
+    static const int MaxPieces = 4;
+    static const int BlockSize = 256;
+    static const int PairCount = BoardSquares * (BoardSquares - 1) / 2;
+
+    TableMaterial() = default;
+    TableMaterial(const std::vector<PieceType> &playerOne, const std::vector<PieceType> &playerTwo);
+    static bool parse(const std::string &name, TableMaterial &material);
+    // the material of the position, false when it has no table or the table cannot hold it
+    static bool of(const BoardState &state, TableMaterial &material);
+
+    std::string name() const;
+    int pieceCount() const { return count; }
+    std::uint64_t positionCount() const;
+    // memory buildTable needs for the material
+    std::uint64_t buildBytes() const { return positionCount() * 5; }
+    // small number unique to the material, for table lookups
+    int key() const;
+
+    // index of the position, false for a position the table does not hold
+    bool index(const BoardState &state, std::uint64_t &index) const;
+    // sets up the position of index on state, which must be empty; false for an
+    // impossible one, two pieces on a square
+    bool place(std::uint64_t index, BoardState &state) const;
+
+    PieceType type(int slot) const { return types[slot]; }
+    bool isPlayerOne(int slot) const { return slot < sideCount[0]; }
+
+private:
+    void finish();
+
+    PieceType types[MaxPieces] = {};
+    int sideCount[2] = {0, 0};
+    int count = 0;
+    bool hasUsesBit[MaxPieces] = {};
+    int usesBits = 0;
+    int pairSlot = -1; // the second of two identical pieces of one side
+};
+
+// a set of tables from a directory, every .cgt file mapped
+class Tablebases {
+public:
+    Tablebases();
+    ~Tablebases();
+    Tablebases(const Tablebases &) = delete;
+    Tablebases &operator=(const Tablebases &) = delete;
+
+    bool open(const std::string &directory, std::string *error = nullptr);
+    bool add(const std::string &path, std::string *error = nullptr);
+    int maxPieces() const { return largest; }
+    std::size_t tableCount() const { return tables.size(); }
+
+    // the value of the position from the side to move; false when no table holds it
+    bool probe(const BoardState &state, TableValue &value) const;
+
+private:
+    struct Table;
+    std::vector<std::unique_ptr<Table>> tables;
+    std::vector<const Table *> byKey;
+    int largest = 0;
+};
+
+struct TableBuildStats {
+    std::uint64_t positions = 0;
+    std::uint64_t wins = 0;
+    std::uint64_t losses = 0;
+    std::uint64_t draws = 0;
+    int longest = 0;            // plies of the longest win
+    std::uint64_t bytes = 0;    // of the file
+};
+
+// positions buildTable can number; KNvKN has more
+const std::uint64_t MaxBuildPositions = 0xFFFFFFFFull;
+
+// retrograde analysis of one material on the given number of threads; every
+// material a capture leads to must already be in known
+bool buildTable(const TableMaterial &material, const Tablebases &known, const std::string &output, int threads,
+                TableBuildStats *stats = nullptr, std::string *error = nullptr);
+
+// every material with both Kings and up to pieces pieces, smaller ones first
+std::vector<TableMaterial> tableMaterials(int pieces);
+
+#endif // TABLEBASE_H
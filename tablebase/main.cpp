@@ -0,0 +1,220 @@
+// main.cpp
+// tablebase: endgame tables for both Kings and up to two more pieces
+//
+//   tablebase generate DIR [--pieces N] [--threads N] [--memory GB] [MATERIAL...]
+//   tablebase probe DIR [--record FILE [--ply N] | --scenario FILE] [--bench]
+//
+// generate writes DIR/MATERIAL.cgt for the materials given, or for every material of
+// up to N pieces (3), smaller ones first; tables already in DIR are kept and used.
+// A material that needs more than GB (16) of memory to build, or has more positions
+// than the builder numbers, is skipped with a message.
+// probe prints the table value of the position, the best action by the tables and,
+// with --bench, the probe time
+#include "tablebase.h"
+#include "record.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int usage()
+{
+    std::fprintf(stderr, "usage: tablebase generate DIR [--pieces N] [--threads N] [--memory GB] [MATERIAL...]\n"
+                         "       tablebase probe DIR [--record FILE [--ply N] | --scenario FILE] [--bench]\n");
+    return 2;
+}
+
+static std::string valueText(const TableValue &value)
+{
+    switch (value.kind) {
+    case TableValue::Win:  return "win in " + std::to_string(value.plies) + " plies";
+    case TableValue::Loss: return "loss in " + std::to_string(value.plies) + " plies";
+    default:               return "draw";
+    }
+}
+
+static int generate(int argc, char *argv[])
+{
+    const char *directory = argc > 2 ? argv[2] : nullptr;
+    int pieces = 0;
+    double memoryGb = 16;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<TableMaterial> materials;
+    for (int i = 3; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        TableMaterial material;
+        if (std::strcmp(argv[i], "--pieces") == 0 && hasValue) {
+            pieces = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--memory") == 0 && hasValue) {
+            memoryGb = std::atof(argv[++i]);
+        } else if (TableMaterial::parse(argv[i], material)) {
+            materials.push_back(material);
+        } else {
+            std::fprintf(stderr, "%s is not a material\n", argv[i]);
+            return usage();
+        }
+    }
+    if (!directory) {
+        return usage();
+    }
+    if (materials.empty()) {
+        if (pieces == 0) {
+            pieces = 3;
+            std::printf("every material of up to 3 pieces, --pieces 4 adds the 4-piece ones\n");
+        }
+        materials = tableMaterials(pieces);
+    }
+    std::stable_sort(materials.begin(), materials.end(), [](const TableMaterial &a, const TableMaterial &b) {
+        return a.pieceCount() < b.pieceCount();
+    });
+
+    std::error_code code;
+    std::filesystem::create_directories(directory, code);
+    Tablebases known;
+    std::string error;
+    if (!known.open(directory, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    int skipped = 0;
+    for (const TableMaterial &material : materials) {
+        std::string path = std::string(directory) + "/" + material.name() + ".cgt";
+        if (std::filesystem::exists(path, code)) {
+            continue;
+        }
+        // nothing smaller needs a 4-piece table, the run goes on without it
+        double needGb = material.buildBytes() / 1e9;
+        if (material.positionCount() > MaxBuildPositions || needGb > memoryGb) {
+            std::printf("%-8s skipped: %llu positions need %.1f GB to build%s\n", material.name().c_str(),
+                        static_cast<unsigned long long>(material.positionCount()), needGb,
+                        material.positionCount() > MaxBuildPositions ? ", more than the builder numbers" : "");
+            std::fflush(stdout);
+            ++skipped;
+            continue;
+        }
+        TableBuildStats stats;
+        auto begin = std::chrono::steady_clock::now();
+        if (!buildTable(material, known, path, threads, &stats, &error) || !known.add(path, &error)) {
+            std::fprintf(stderr, "%s: %s\n", material.name().c_str(), error.c_str());
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::uint64_t legal = stats.wins + stats.losses + stats.draws;
+        std::printf("%-8s %12llu positions  wins %5.1f%%  losses %5.1f%%  draws %5.1f%%  longest %3d  %10llu bytes  %.1f s\n",
+                    material.name().c_str(), static_cast<unsigned long long>(legal),
+                    100.0 * stats.wins / legal, 100.0 * stats.losses / legal, 100.0 * stats.draws / legal,
+                    stats.longest, static_cast<unsigned long long>(stats.bytes), seconds);
+        std::fflush(stdout);
+    }
+    if (skipped > 0) {
+        std::printf("%d materials skipped\n", skipped);
+    }
+    return 0;
+}
+
+static int probe(int argc, char *argv[])
+{
+    const char *directory = argc > 2 ? argv[2] : nullptr;
+    const char *recordPath = nullptr;
+    const char *scenarioPath = nullptr;
+    int ply = -1;
+    bool bench = false;
+    for (int i = 3; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ply") == 0 && hasValue) {
+            ply = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--scenario") == 0 && hasValue) {
+            scenarioPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            return usage();
+        }
+    }
+    if (!directory || (recordPath && scenarioPath) || (!recordPath && !scenarioPath)) {
+        return usage();
+    }
+
+    Tablebases tables;
+    std::string error;
+    if (!tables.open(directory, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    BoardState state;
+    if (recordPath) {
+        GameRecord record;
+        if (!loadRecordFile(recordPath, record, &error) || !replayRecord(record, ply, state, &error)) {
+            std::fprintf(stderr, "%s: %s\n", recordPath, error.c_str());
+            return 1;
+        }
+    } else {
+        Scenario scenario;
+        if (!loadScenarioFile(scenarioPath, scenario, &error) || !scenarioToState(scenario, state, &error)) {
+            std::fprintf(stderr, "%s: %s\n", scenarioPath, error.c_str());
+            return 1;
+        }
+    }
+
+    TableValue value;
+    if (!tables.probe(state, value)) {
+        std::printf("not in the %zu tables\n", tables.tableCount());
+        return 0;
+    }
+    std::printf("%s\n", valueText(value).c_str());
+
+    // the action that keeps the value: the quickest win, the longest loss
+    ActionList list;
+    generateActions(state, list);
+    for (const Action &action : list) {
+        BoardState next = state;
+        applyAction(next, action);
+        TableValue reply;
+        bool known = tables.probe(next, reply);
+        bool ends = next.result != GameResult::Ongoing;
+        // not a blast that takes the mover's own King
+        bool moverWins = next.result == (state.playerOneToMove() ? GameResult::PlayerOneWins : GameResult::PlayerTwoWins);
+        bool keeps = value.kind == TableValue::Win
+            ? (moverWins && value.plies == 1)
+                || (known && reply.kind == TableValue::Loss && reply.plies + 1 == value.plies)
+            : value.kind == TableValue::Loss ? (ends && value.plies == 1) || (known && reply.kind == TableValue::Win
+                                                                             && reply.plies + 1 == value.plies)
+                                              : (ends && next.result == GameResult::Draw) || (known && reply.kind == TableValue::Draw);
+        if (keeps) {
+            std::printf("best %s\n", actionNotation(action).c_str());
+            break;
+        }
+    }
+
+    if (bench) {
+        const int rounds = 1000000;
+        int found = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            found += tables.probe(state, value);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("probe %.0f ns (%d found)\n", 1e9 * seconds / rounds, found);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::strcmp(argv[1], "generate") == 0) {
+        return generate(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "probe") == 0) {
+        return probe(argc, argv);
+    }
+    return usage();
+}
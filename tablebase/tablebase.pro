@@ -0,0 +1,10 @@
+# tablebase.pro
+# generates and probes the endgame tables
+TEMPLATE = app
+TARGET = tablebase
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
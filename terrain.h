@@ -1,9 +1,10 @@
 #ifndef TERRAIN_H
 #define TERRAIN_H
 
-#include <vector>
+#include <cstdint>
+#include "board.h"
 
-enum class TerrainType {
+enum class TerrainType : std::uint8_t {
     Land,
     Forest,
     Mountain,
@@ -11,18 +12,88 @@ enum class TerrainType {
     Desert
 };
 
+const int TerrainTypeCount = 5;
+
+// one byte per square, row by row, plus a bitboard per terrain type;
+// the map is at most the size of the board
 class Terrain {
 public:
-    Terrain(int rows, int cols);
-    TerrainType getTerrain(int x, int y) const;
+    constexpr Terrain(int rows = BoardRows, int cols = BoardCols) : rows(rows), cols(cols) {
+        masks[static_cast<int>(TerrainType::Land)] = inside();
+    }
+    TerrainType getTerrain(int x, int y) const; // x is the row, Land outside the map
     void setupTerrain(); // initialization
     int getRows() const;
     int getCols() const;
 
+    // unchecked, by square index y * BoardCols + x
+    constexpr TerrainType at(int sq) const { return squares[sq]; }
+    constexpr Bitboard mask(TerrainType type) const { return masks[static_cast<int>(type)]; }
+    constexpr void set(int row, int col, TerrainType type);
+
+    // the setupTerrain layout, built at compile time
+    static constexpr Terrain standard(int rows = BoardRows, int cols = BoardCols);
+
 private:
+    constexpr Bitboard inside() const {
+        Bitboard bits;
+        for (int row = 0; row < rows; ++row) {
+            for (int col = 0; col < cols; ++col) {
+                bits.set(row * BoardCols + col);
+            }
+        }
+        return bits;
+    }
+
     int rows;
     int cols;
-    std::vector<std::vector<TerrainType>> boardTerrain;
+    TerrainType squares[BoardSquares] = {};
+    Bitboard masks[TerrainTypeCount] = {};
 };
 
+constexpr void Terrain::set(int row, int col, TerrainType type)
+{
+    int sq = row * BoardCols + col;
+    masks[static_cast<int>(squares[sq])].clear(sq);
+    squares[sq] = type;
+    masks[static_cast<int>(type)].set(sq);
+}
+
+constexpr Terrain Terrain::standard(int rows, int cols)
+{
+    Terrain map(rows, cols);
+
+    // river across the middle row, bridges in columns 3 and 7
+    int riverRow = rows / 2;
+    for (int col = 0; col < cols; ++col) {
+        if (col != 3 && col != 7) {
+            map.set(riverRow, col, TerrainType::River);
+        }
+    }
+
+    // upper half as {row, col}, mirrored onto the lower half
+    struct Spot {
+        int row;
+        int col;
+        TerrainType type;
+    };
+    const Spot spots[] = {
+        {2, 1, TerrainType::Mountain}, {2, 2, TerrainType::Mountain},
+        {3, 5, TerrainType::Mountain}, {3, 6, TerrainType::Mountain},
+        {1, 5, TerrainType::Desert}, {2, 6, TerrainType::Desert}, {3, 7, TerrainType::Desert},
+        {4, 8, TerrainType::Forest}, {4, 1, TerrainType::Forest}, {4, 2, TerrainType::Forest},
+        {3, 9, TerrainType::Forest}, {4, 9, TerrainType::Forest}, {1, 10, TerrainType::Forest},
+    };
+    for (const Spot &spot : spots) {
+        if (spot.row < riverRow && spot.col < cols) {
+            map.set(spot.row, spot.col, spot.type);
+            map.set(rows - 1 - spot.row, spot.col, spot.type);
+        }
+    }
+    return map;
+}
+
+// the standard map of the board size
+extern const Terrain defaultTerrain;
+
 #endif // TERRAIN_H
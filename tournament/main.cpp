@@ -0,0 +1,381 @@
+// main.cpp
+// tournament: engine-vs-engine games from the standard terrain and piece setup
+//
+//   tournament [games] [--threads N] [--nodes N | --depth D | --time ms] [--mcts]
+//              [--random-plies K] [--max-plies P] [--seed S] [--scenarios DIR] [--record DIR]
+//              [--book FILE] [--tablebases DIR]
+//
+// both sides use the same engine, so the results measure the balance of the setup;
+// every game opens with K random actions to spread the games out.
+// --scenarios maps the .cgs files of DIR and starts game n from scenario n modulo their count,
+// --record streams every game to DIR/gameNNNNNN.cgr for the replay tool,
+// --book answers book positions from an opening book instead of searching them,
+// --tablebases scores the endgames the tables of DIR hold exactly
+#include "search.h"
+#include "mcts.h"
+#include "book.h"
+#include "tablebase.h"
+#include "record.h"
+#include "scenario.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class GameEnd {
+    KingTaken,     // a side lost its King
+    Wiped,         // a side lost its last piece
+    NoAction,      // the side to move was stuck: draw
+    Repetition,    // third time in the same position: draw
+    PlyLimit,      // too long: draw
+    Count
+};
+
+const char *const gameEndNames[] = {"king captured", "last piece lost", "no legal action", "repetition", "ply limit"};
+
+struct TournamentOptions {
+    int games = 1000;
+    int threads = 1;
+    SearchLimits limits;
+    bool mcts = false;
+    int mctsRollouts = 2000;
+    int randomPlies = 4;
+    int maxPlies = 300;
+    std::uint64_t seed = 1;
+    const ScenarioDirectory *scenarios = nullptr; // standard setup when null
+    const char *recordDirectory = nullptr;
+    const OpeningBook *book = nullptr;
+    const Tablebases *tablebases = nullptr;
+};
+
+struct TournamentStats {
+    int results[4] = {};                          // by GameResult
+    int ends[static_cast<int>(GameEnd::Count)] = {};
+    long long totalPlies = 0;
+    long long squaredPlies = 0;
+    long long abilityUses[2][PieceTypeCount] = {};   // by side and piece type
+    int gamesWithAbility[2][PieceTypeCount] = {};
+    long long bookActions = 0;
+    int played = 0;
+};
+
+static std::uint64_t nextRandom(std::uint64_t &state)
+{
+    // splitmix64
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Wilson score interval, 95%
+static void wilson(int hits, int total, double &low, double &high)
+{
+    if (total == 0) {
+        low = high = 0;
+        return;
+    }
+    const double z = 1.96;
+    double p = static_cast<double>(hits) / total;
+    double denominator = 1 + z * z / total;
+    double centre = (p + z * z / (2.0 * total)) / denominator;
+    double margin = z * std::sqrt(p * (1 - p) / total + z * z / (4.0 * total * total)) / denominator;
+    low = centre - margin;
+    high = centre + margin;
+}
+
+// one game; game decides the random opening so every run gives the same games
+static void playGame(const TournamentOptions &options, int game, Search &search, Mcts &mcts, TournamentStats &stats)
+{
+    std::uint64_t random = options.seed * 0x100000001B3ULL + static_cast<std::uint64_t>(game);
+    BoardState state = initialBoardState();
+    if (options.scenarios) {
+        const auto &views = options.scenarios->scenarios();
+        scenarioToState(views[static_cast<std::size_t>(game) % views.size()], state); // checked in main
+    }
+    RecordWriter record;
+    if (options.recordDirectory) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/game%06d.cgr", game);
+        record.open(options.recordDirectory + std::string(name), state);
+    }
+    std::vector<std::uint64_t> keys;
+    bool usedAbility[2][PieceTypeCount] = {};
+    GameEnd end = GameEnd::PlyLimit;
+    search.transpositionTable().clear();
+    search.setBook(options.book, random);
+    mcts.setBook(options.book, random);
+    search.setTablebases(options.tablebases);
+    mcts.setTablebases(options.tablebases);
+
+    MctsLimits mctsLimits;
+    mctsLimits.timeMs = 0;
+    mctsLimits.maxRollouts = options.mctsRollouts;
+
+    while (state.plyCount < options.maxPlies) {
+        Action action;
+        bool found;
+        if (state.plyCount < options.randomPlies) {
+            ActionList list;
+            generateActions(state, list);
+            found = list.size > 0;
+            if (found) {
+                action = list[static_cast<int>(nextRandom(random) % list.size)];
+            }
+        } else if (options.mcts) {
+            MctsResult result = mcts.think(state, mctsLimits);
+            found = result.found;
+            action = result.best;
+            stats.bookActions += result.fromBook;
+        } else {
+            SearchResult result = search.think(state, options.limits, keys);
+            found = result.found;
+            action = result.best;
+            stats.bookActions += result.fromBook;
+        }
+        if (!found) {
+            end = GameEnd::NoAction;
+            state.result = GameResult::Draw;
+            break;
+        }
+
+        if (action.isAbility) {
+            const PieceState &piece = state.squares[action.from];
+            int side = BoardState::side(piece.isPlayerOne);
+            ++stats.abilityUses[side][static_cast<int>(piece.type)];
+            usedAbility[side][static_cast<int>(piece.type)] = true;
+        }
+        keys.push_back(state.hash);
+        applyAction(state, action);
+        record.write(action);
+
+        if (state.result != GameResult::Ongoing) {
+            bool wiped = state.pieceCount[0] == 0 || state.pieceCount[1] == 0;
+            end = wiped ? GameEnd::Wiped : GameEnd::KingTaken;
+            break;
+        }
+        int seen = 0;
+        for (std::uint64_t key : keys) {
+            seen += key == state.hash;
+        }
+        if (seen >= 2) {
+            end = GameEnd::Repetition;
+            break;
+        }
+    }
+    if (state.result == GameResult::Ongoing) {
+        state.result = GameResult::Draw;
+    }
+
+    ++stats.results[static_cast<int>(state.result)];
+    ++stats.ends[static_cast<int>(end)];
+    stats.totalPlies += state.plyCount;
+    stats.squaredPlies += static_cast<long long>(state.plyCount) * state.plyCount;
+    for (int side = 0; side < 2; ++side) {
+        for (int type = 0; type < PieceTypeCount; ++type) {
+            stats.gamesWithAbility[side][type] += usedAbility[side][type];
+        }
+    }
+    ++stats.played;
+}
+
+static void printReport(const TournamentStats &stats, double seconds)
+{
+    int games = stats.played;
+    std::printf("games %d  %.1fs  %.2f games/s\n", games, seconds, seconds > 0 ? games / seconds : 0.0);
+    if (games == 0) {
+        return;
+    }
+
+    const struct { const char *name; GameResult result; } outcomes[] = {
+        {"Player 1 wins", GameResult::PlayerOneWins},
+        {"draws        ", GameResult::Draw},
+        {"Player 2 wins", GameResult::PlayerTwoWins},
+    };
+    for (const auto &outcome : outcomes) {
+        int count = stats.results[static_cast<int>(outcome.result)];
+        double low, high;
+        wilson(count, games, low, high);
+        std::printf("%s %6d  %5.1f%%  [%5.1f%%, %5.1f%%]\n",
+                    outcome.name, count, 100.0 * count / games, 100.0 * low, 100.0 * high);
+    }
+
+    // score of Player 1 with a normal interval over the per-game scores
+    double wins = stats.results[static_cast<int>(GameResult::PlayerOneWins)];
+    double draws = stats.results[static_cast<int>(GameResult::Draw)];
+    double score = (wins + draws / 2) / games;
+    double variance = (wins + draws / 4) / games - score * score;
+    double margin = 1.96 * std::sqrt(std::max(variance, 0.0) / games);
+    std::printf("Player 1 score %.3f +- %.3f\n", score, margin);
+
+    double meanPlies = static_cast<double>(stats.totalPlies) / games;
+    double spread = std::sqrt(std::max(0.0, static_cast<double>(stats.squaredPlies) / games - meanPlies * meanPlies));
+    std::printf("average length %.1f plies (sd %.1f)\n", meanPlies, spread);
+    if (stats.bookActions > 0) {
+        std::printf("book actions %.1f per game\n", static_cast<double>(stats.bookActions) / games);
+    }
+
+    std::printf("game ends:\n");
+    for (int end = 0; end < static_cast<int>(GameEnd::Count); ++end) {
+        std::printf("    %-16s %6d  %5.1f%%\n", gameEndNames[end], stats.ends[end], 100.0 * stats.ends[end] / games);
+    }
+
+    std::printf("abilities          uses/game P1  P2    games used P1  P2\n");
+    const PieceType users[] = {PieceType::Knight, PieceType::Bomb, PieceType::Queen, PieceType::King, PieceType::Bishop};
+    for (PieceType type : users) {
+        int t = static_cast<int>(type);
+        std::printf("    %-12s   %8.2f  %8.2f    %6.1f%%  %6.1f%%\n", pieceTypeName(type),
+                    static_cast<double>(stats.abilityUses[0][t]) / games,
+                    static_cast<double>(stats.abilityUses[1][t]) / games,
+                    100.0 * stats.gamesWithAbility[0][t] / games,
+                    100.0 * stats.gamesWithAbility[1][t] / games);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    TournamentOptions options;
+    options.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    options.limits.timeMs = 0;
+    options.limits.maxNodes = 20000;
+    const char *scenarioPath = nullptr;
+    const char *bookPath = nullptr;
+    const char *tablePath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--nodes") == 0 && hasValue) {
+            options.limits.maxNodes = std::strtoull(argv[++i], nullptr, 10);
+            options.mctsRollouts = static_cast<int>(options.limits.maxNodes);
+        } else if (std::strcmp(argv[i], "--depth") == 0 && hasValue) {
+            options.limits.maxDepth = std::atoi(argv[++i]);
+            options.limits.maxNodes = 0;
+        } else if (std::strcmp(argv[i], "--time") == 0 && hasValue) {
+            options.limits.timeMs = std::atoi(argv[++i]);
+            options.limits.maxNodes = 0;
+        } else if (std::strcmp(argv[i], "--mcts") == 0) {
+            options.mcts = true;
+        } else if (std::strcmp(argv[i], "--random-plies") == 0 && hasValue) {
+            options.randomPlies = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-plies") == 0 && hasValue) {
+            options.maxPlies = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--scenarios") == 0 && hasValue) {
+            scenarioPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+            options.recordDirectory = argv[++i];
+        } else if (std::strcmp(argv[i], "--book") == 0 && hasValue) {
+            bookPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--tablebases") == 0 && hasValue) {
+            tablePath = argv[++i];
+        } else if (std::atoi(argv[i]) > 0) {
+            options.games = std::atoi(argv[i]);
+        } else {
+            std::fprintf(stderr, "usage: tournament [games] [--threads N] [--nodes N | --depth D | --time ms] [--mcts]\n"
+                                 "                  [--random-plies K] [--max-plies P] [--seed S] [--scenarios DIR] [--record DIR]\n"
+                                 "                  [--book FILE] [--tablebases DIR]\n");
+            return 2;
+        }
+    }
+
+    ScenarioDirectory scenarios;
+    if (scenarioPath) {
+        std::string error;
+        if (!scenarios.open(scenarioPath, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (scenarios.scenarios().empty()) {
+            std::fprintf(stderr, "%s: no .cgs scenarios\n", scenarioPath);
+            return 1;
+        }
+        for (const ScenarioView &view : scenarios.scenarios()) {
+            BoardState state;
+            if (!scenarioToState(view, state, &error)) {
+                std::fprintf(stderr, "%s: %s\n", scenarioPath, error.c_str());
+                return 1;
+            }
+        }
+        options.scenarios = &scenarios;
+        std::printf("%zu scenarios from %s\n", scenarios.scenarios().size(), scenarioPath);
+    }
+
+    OpeningBook book;
+    if (bookPath) {
+        std::string error;
+        if (!book.open(bookPath, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        options.book = &book;
+        std::printf("%zu book entries from %s\n", book.size(), bookPath);
+    }
+
+    Tablebases tablebases;
+    if (tablePath) {
+        std::string error;
+        if (!tablebases.open(tablePath, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        options.tablebases = &tablebases;
+        std::printf("%zu endgame tables from %s\n", tablebases.tableCount(), tablePath);
+    }
+
+    // one game per thread at a time, each thread with its own engines and counts
+    std::atomic<int> nextGame{0};
+    std::vector<TournamentStats> threadStats(options.threads);
+    std::mutex progressLock;
+    int finished = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto work = [&](int id) {
+        Search search(1, 4);
+        Mcts mcts(1, 1 << 18);
+        for (int game = nextGame++; game < options.games; game = nextGame++) {
+            playGame(options, game, search, mcts, threadStats[id]);
+            std::lock_guard<std::mutex> guard(progressLock);
+            if (++finished % 100 == 0) {
+                std::fprintf(stderr, "\r%d/%d games", finished, options.games);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int id = 0; id < options.threads; ++id) {
+        workers.emplace_back(work, id);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (finished >= 100) {
+        std::fprintf(stderr, "\n");
+    }
+
+    TournamentStats total;
+    for (const TournamentStats &stats : threadStats) {
+        for (int i = 0; i < 4; ++i) {
+            total.results[i] += stats.results[i];
+        }
+        for (int i = 0; i < static_cast<int>(GameEnd::Count); ++i) {
+            total.ends[i] += stats.ends[i];
+        }
+        total.totalPlies += stats.totalPlies;
+        total.squaredPlies += stats.squaredPlies;
+        for (int side = 0; side < 2; ++side) {
+            for (int type = 0; type < PieceTypeCount; ++type) {
+                total.abilityUses[side][type] += stats.abilityUses[side][type];
+                total.gamesWithAbility[side][type] += stats.gamesWithAbility[side][type];
+            }
+        }
+        total.bookActions += stats.bookActions;
+        total.played += stats.played;
+    }
+    printReport(total, seconds);
+    return 0;
+}
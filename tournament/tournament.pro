@@ -0,0 +1,10 @@
+# tournament.pro
+# engine-vs-engine games from the standard setup or a scenario directory, results for balancing
+TEMPLATE = app
+TARGET = tournament
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(../core.pri)
+
+SOURCES += main.cpp
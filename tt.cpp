@@ -0,0 +1,160 @@
+// tt.cpp
+#include "tt.h"
+#include "eval.h"
+
+namespace {
+
+std::uint64_t packEntry(const TTEntry &entry)
+{
+    return std::uint64_t(std::uint16_t(entry.score)) | std::uint64_t(entry.depth) << 16
+        | std::uint64_t(entry.genBound) << 24 | std::uint64_t(entry.action) << 32;
+}
+
+TTEntry unpackEntry(std::uint64_t data)
+{
+    TTEntry entry;
+    entry.score = static_cast<std::int16_t>(data);
+    entry.depth = static_cast<std::uint8_t>(data >> 16);
+    entry.genBound = static_cast<std::uint8_t>(data >> 24);
+    entry.action = static_cast<std::uint32_t>(data >> 32);
+    return entry;
+}
+
+void writeSlot(TTSlot &slot, std::uint64_t key, const TTEntry &entry)
+{
+    std::uint64_t data = packEntry(entry);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(int megabytes)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(int megabytes)
+{
+    std::size_t size = 1;
+    while (size * 2 * sizeof(TTBucket) <= std::size_t(megabytes) * 1024 * 1024) {
+        size *= 2;
+    }
+    buckets.reset(new TTBucket[size]);
+    count = size;
+    generation = 0;
+}
+
+void TranspositionTable::clear()
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        for (TTSlot &slot : buckets[i].slots) {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, TTEntry &found) const
+{
+    for (const TTSlot &slot : bucketFor(key).slots) {
+        std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.check.load(std::memory_order_relaxed) ^ data) == key) {
+            found = unpackEntry(data);
+            return found.bound() != Bound::None;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, int score, int depth, Bound bound, const Action *best)
+{
+    TTBucket &bucket = bucketFor(key);
+
+    // same position first, otherwise the shallowest entry, entries of older searches count as shallower
+    TTSlot *replace = &bucket.slots[0];
+    TTEntry old = unpackEntry(replace->data.load(std::memory_order_relaxed));
+    bool samePosition = false;
+    int replaceWorth = 1 << 30;
+    for (TTSlot &slot : bucket.slots) {
+        std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+        TTEntry entry = unpackEntry(data);
+        samePosition = (slot.check.load(std::memory_order_relaxed) ^ data) == key;
+        if (samePosition || entry.bound() == Bound::None) {
+            replace = &slot;
+            old = entry;
+            break;
+        }
+        int age = (generation - entry.generation()) & 63;
+        int worth = entry.depth - 8 * age;
+        if (worth < replaceWorth) {
+            replaceWorth = worth;
+            replace = &slot;
+            old = entry;
+        }
+    }
+
+    // keep a deeper result of this search unless the new one is exact, only refresh its action
+    if (samePosition && old.generation() == generation && depth < old.depth && bound != Bound::Exact) {
+        if (best) {
+            old.action = packAction(*best);
+            writeSlot(*replace, key, old);
+        }
+        return;
+    }
+
+    TTEntry entry;
+    entry.action = best ? packAction(*best) : 0;
+    if (samePosition && !entry.action) {
+        entry.action = old.action; // keep the old best action when the new result has none
+    }
+    entry.score = static_cast<std::int16_t>(score);
+    entry.depth = static_cast<std::uint8_t>(depth < 0 ? 0 : depth);
+    entry.genBound = static_cast<std::uint8_t>(generation << 2 | static_cast<int>(bound));
+    writeSlot(*replace, key, entry);
+}
+
+int TranspositionTable::hashfull() const
+{
+    int used = 0;
+    std::size_t sample = count < 250 ? count : 250;
+    for (std::size_t i = 0; i < sample; ++i) {
+        for (const TTSlot &slot : buckets[i].slots) {
+            TTEntry entry = unpackEntry(slot.data.load(std::memory_order_relaxed));
+            used += entry.bound() != Bound::None && entry.generation() == generation;
+        }
+    }
+    return static_cast<int>(used * 1000 / (sample * TTBucket::Ways));
+}
+
+// bit 31 set for a real action, bit 30 for an ability, then 15 bits of from and to
+std::uint32_t TranspositionTable::packAction(const Action &action)
+{
+    return 0x80000000u | (action.isAbility ? 0x40000000u : 0) | std::uint32_t(action.from) << 15 | action.to;
+}
+
+bool TranspositionTable::unpackAction(std::uint32_t packed, Action &action)
+{
+    if (!(packed & 0x80000000u)) {
+        return false;
+    }
+    action.from = static_cast<Square>((packed >> 15) & 0x7FFF);
+    action.to = static_cast<Square>(packed & 0x7FFF);
+    action.isAbility = (packed & 0x40000000u) != 0;
+    return true;
+}
+
+int scoreToTable(int score, int ply)
+{
+    if (score >= MateScore - MaxMateDistance) return score + ply;
+    if (score <= -(MateScore - MaxMateDistance)) return score - ply;
+    return score;
+}
+
+int scoreFromTable(int score, int ply)
+{
+    if (score >= MateScore - MaxMateDistance) return score - ply;
+    if (score <= -(MateScore - MaxMateDistance)) return score + ply;
+    return score;
+}
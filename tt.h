@@ -0,0 +1,72 @@
+// tt.h
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "movegen.h"
+
+enum class Bound : std::uint8_t {
+    None,
+    Upper,  // all actions failed low
+    Lower,  // cut-off
+    Exact
+};
+
+// what a probe hands back
+struct TTEntry {
+    std::uint32_t action = 0;    // packed Action, 0 for none
+    std::int16_t score = 0;
+    std::uint8_t depth = 0;
+    std::uint8_t genBound = 0;   // generation << 2 | Bound
+
+    Bound bound() const { return static_cast<Bound>(genBound & 3); }
+    std::uint8_t generation() const { return genBound >> 2; }
+};
+
+// lock-free slot: the key is stored xor-ed with the data, so a slot torn by
+// two threads writing at once fails the check instead of returning mixed data
+struct TTSlot {
+    std::atomic<std::uint64_t> check{0};
+    std::atomic<std::uint64_t> data{0};
+};
+
+// one cache line per bucket
+struct alignas(64) TTBucket {
+    static const int Ways = 4;
+    TTSlot slots[Ways];
+};
+
+// fixed-size transposition table with generation-based replacement,
+// shared by all search threads without locks
+class TranspositionTable {
+public:
+    explicit TranspositionTable(int megabytes = 16);
+
+    void resize(int megabytes);
+    void clear();
+    void newSearch() { generation = (generation + 1) & 63; } // ages the older entries
+
+    // copies the entry for the key into found, false when there is none
+    bool probe(std::uint64_t key, TTEntry &found) const;
+    void store(std::uint64_t key, int score, int depth, Bound bound, const Action *best);
+
+    int hashfull() const; // permille of sampled entries written by this search
+
+    static std::uint32_t packAction(const Action &action);
+    static bool unpackAction(std::uint32_t packed, Action &action);
+
+private:
+    TTBucket &bucketFor(std::uint64_t key) const { return buckets[key & (count - 1)]; }
+
+    std::unique_ptr<TTBucket[]> buckets;
+    std::size_t count = 0; // power of two
+    std::uint8_t generation = 0;
+};
+
+// mate scores are stored relative to the node, not the root
+int scoreToTable(int score, int ply);
+int scoreFromTable(int score, int ply);
+
+#endif // TT_H
@@ -0,0 +1,13 @@
+// zobrist.cpp
+#include "zobrist.h"
+
+constexpr ZobristKeys zobristKeys;
+
+std::uint64_t computeHash(const BoardState &state)
+{
+    std::uint64_t hash = state.playerOneToMove() ? 0 : zobristKeys.playerTwoToMove;
+    for (int sq = 0; sq < BoardSquares; ++sq) {
+        hash ^= pieceKey(sq, state.squares[sq]);
+    }
+    return hash;
+}
@@ -0,0 +1,52 @@
+// zobrist.h
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include "rules.h"
+
+// random keys per square, owner, piece type and ability uses left (0, 1, 2),
+// so a spent Knight charge, King swap or Bishop spawn changes the key
+struct ZobristKeys {
+    static const int AbilityStates = 3;
+    std::uint64_t piece[BoardSquares][2][PieceTypeCount][AbilityStates] = {};
+    std::uint64_t playerTwoToMove = 0;
+
+    constexpr ZobristKeys() {
+        std::uint64_t seed = 0x43686573734761ULL; // fixed, keys are stored in files
+        for (auto &square : piece) {
+            for (auto &owner : square) {
+                for (auto &type : owner) {
+                    for (auto &key : type) {
+                        key = next(seed);
+                    }
+                }
+            }
+        }
+        playerTwoToMove = next(seed);
+    }
+
+    // splitmix64
+    static constexpr std::uint64_t next(std::uint64_t &seed) {
+        std::uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+extern const ZobristKeys zobristKeys;
+
+inline std::uint64_t pieceKey(int sq, const PieceState &piece)
+{
+    if (piece.type == PieceType::None) {
+        return 0;
+    }
+    int uses = piece.abilityUsesLeft < ZobristKeys::AbilityStates ? piece.abilityUsesLeft : ZobristKeys::AbilityStates - 1;
+    return zobristKeys.piece[sq][BoardState::side(piece.isPlayerOne)][static_cast<int>(piece.type)][uses];
+}
+
+// key from scratch; BoardState::hash keeps the same value incrementally
+std::uint64_t computeHash(const BoardState &state);
+
+#endif // ZOBRIST_H